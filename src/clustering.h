@@ -34,12 +34,42 @@ public:
 		double threshold,
 		std::vector<int>& assignments) = 0;
 
+	// Clusters objects at several thresholds. By default the algorithm is invoked separately 
+	// for each threshold, thus it must leave the matrix intact. Returns numbers of clusters.
+	virtual std::vector<int> clusterThresholds(
+		SparseMatrix<Distance>& distances,
+		const std::vector<int>& objects,
+		const std::vector<double>& thresholds,
+		std::vector<std::vector<int>>& assignments) {
+
+		std::vector<int> n_clusters(thresholds.size());
+		assignments.assign(thresholds.size(), std::vector<int>());
+
+		for (size_t i = 0; i < thresholds.size(); ++i) {
+			n_clusters[i] = (*this)(distances, objects, thresholds[i], assignments[i]);
+		}
+
+		return n_clusters;
+	}
+
 	virtual ~IClustering() {};
 
 };
 
 template <class Distance>
 class HierarchicalClustering : public IClustering<Distance> {
+protected:
+	// when set, the dendrogram is built completely (not only up to the threshold) and kept
+	bool keepDendrogram{ false };
+
+	// dendrogram of the last clustering: first n nodes are objects, the following ones are merges
+	std::vector<node_t> lastDendrogram;
+
+public:
+	void setKeepDendrogram(bool keep) { keepDendrogram = keep; }
+
+	std::vector<node_t> releaseDendrogram() { return std::move(lastDendrogram); }
+
 protected:
 	
 	void makeDendrogram(
@@ -70,7 +100,9 @@ protected:
 		}
 	}
 	
-	int dendrogramToAssignments(
+public:
+	// Cuts the dendrogram at the threshold in O(n), assignments have to be sized to the number of objects.
+	static int dendrogramToAssignments(
 		const std::vector<node_t>& dendrogram,
 		double threshold,
 		std::vector<int>& assignments) {
@@ -12,6 +12,7 @@
 #include "graph_named.h"
 #include "graph_numbered.h"
 #include "sparse_matrix.h"
+#include "graph_file.h"
 #include "io.h"
 
 #define VAL(str) #str
@@ -64,52 +65,73 @@ std::unique_ptr<Graph> Console::loadGraph(const Params& params) {
 	
 	unique_ptr<Graph> graph;
 
-	if (params.numericIds) {
-		if (needDistances(params.algo)) {
-			graph = make_unique<GraphNumbered<dist_t>>(params.numThreads);
-		}
-		else {
-			graph = make_unique<GraphNumbered<mini_dist_t>>(params.numThreads);
-		}
+	// binary graph and dendrogram determine the type of identifiers by themselves
+	bool numericIds = params.numericIds;
+	if (!params.graphInput.empty()) {
+		numericIds = !GraphFileHeader::read(params.graphInput).isNamed();
 	}
-	else {
-		if (needDistances(params.algo)) {
-			graph = make_unique<GraphNamed<dist_t>>(params.numThreads);
+	else if (!params.dendrogramInput.empty()) {
+		numericIds = !DendrogramFileHeader::read(params.dendrogramInput).isNamed();
+	}
+
+	withDistanceType(params, [&graph, &params, numericIds](auto type) {
+		using Distance = typename decltype(type)::type;
+		if (numericIds) {
+			graph = make_unique<GraphNumbered<Distance>>(params.numThreads);
 		}
 		else {
-			graph = make_unique<GraphNamed<mini_dist_t>>(params.numThreads);
+			graph = make_unique<GraphNamed<Distance>>(params.numThreads);
 		}
-	}
+	});
+
+	graph->setHalfMatrix(params.halfMatrix);
+	graph->setStreaming(params.streaming);
+	graph->setHistogram(params.histogramWidth, params.histogramBins, params.histogramOutput);
 
-	LOG_NORMAL << "Loading pairwise distances from " << params.distancesFile << "... ";
 	auto t = std::chrono::high_resolution_clock::now();
+	size_t n_total_dists = 0;
 
-	vector<char> filebuf(128ULL << 20);  // 128MB buffer
-	ifstream ifs;
-	ifs.rdbuf()->pubsetbuf(filebuf.data(), filebuf.size());
-	ifs.open(params.distancesFile, ios_base::binary);
+	if (!params.dendrogramInput.empty()) {
+		LOG_NORMAL << "Loading dendrogram from " << params.dendrogramInput << "... ";
+		graph->loadDendrogram(params.dendrogramInput, dendrogram);
+
+		auto dt = std::chrono::high_resolution_clock::now() - t;
+		LOG_NORMAL << endl
+			<< "  dendrogram: " << graph->getNumVertices() << " objects, " << dendrogram.size() - graph->getNumVertices() << " merges" << endl
+			<< "  time [s]: " << chrono::duration<double>(dt).count() << endl;
 
-	if (!ifs) {
-		throw std::runtime_error("Unable to open distance file");	
+		return graph;
 	}
 
-	map<DistanceSpecification, distance_transformation_t> transforms{
-		{ DistanceSpecification::Distance, [](double d) { return d; } },
-		{ DistanceSpecification::Similarity,		[](double d) { return 1.0 - d; } },
-		{ DistanceSpecification::PercentSimilarity, [](double d) { return 1.0 - d * 0.01; } },
-	};
+	if (!params.graphInput.empty()) {
+		LOG_NORMAL << "Loading graph from " << params.graphInput << "... ";
+		n_total_dists = graph->loadBinary(params.graphInput);
+	}
+	else {
+		LOG_NORMAL << "Loading pairwise distances from " << params.distancesFile << "... ";
 
-	size_t n_total_dists = graph->load(ifs, params.idColumns, params.distanceColumn,
-		transforms[params.distanceSpecification], params.columns2filters);
+		n_total_dists = graph->load(params.distancesFile, params.inputMode, params.idColumns, params.distanceColumn,
+			getTransform(params.distanceSpecification), params.columns2filters);
+	}
 	
 	auto dt = std::chrono::high_resolution_clock::now() - t;
 
-	ifs.close();
 	LOG_NORMAL << endl
 		<< "  input graph: " << graph->getNumInputVertices() << " nodes, " << n_total_dists << " edges" << endl
-		<< "  filtered graph: " << graph->getNumVertices() << " nodes, " << graph->getNumEdges() << " edges" << endl
+		<< "  filtered graph: " << graph->getNumVertices() << " nodes, " << graph->getNumEdges() 
+		<< (params.streaming ? " streamed edges (including duplicates)" : " edges") << endl
 		<< "  time [s]: " << chrono::duration<double>(dt).count() << endl;
 
+	if (!params.graphOutput.empty()) {
+		LOG_NORMAL << "Saving graph to " << params.graphOutput << "... ";
+		t = std::chrono::high_resolution_clock::now();
+		
+		graph->saveBinary(params.graphOutput);
+		
+		dt = std::chrono::high_resolution_clock::now() - t;
+		LOG_NORMAL << endl << "  time [s]: " << chrono::duration<double>(dt).count() << endl;
+	}
+
 	return graph;
 }
 
@@ -233,34 +255,56 @@ void Console::doClustering(
 	const Params& params,
 	Graph& graph,
 	const std::vector<int>& objects,
-	std::vector<int>& assignments)
+	std::vector<std::vector<int>>& assignments)
 {
 	assignments.clear();
 	
-	LOG_NORMAL << "Clustering (algorithm: " << Params::algo2str(params.algo) << ")... ";
-
-	auto t = std::chrono::high_resolution_clock::now();
-	double threshold = std::nexttoward(std::numeric_limits<double>::max(), 0.0);
-	int n_clusters = 0;
-
-	if (needDistances(params.algo)) {
-		auto clustering = createClusteringAlgo<dist_t>(params);
-		IMatrix& mat = graph.getMatrix();
-		SparseMatrix<dist_t>& distances = static_cast<SparseMatrix<dist_t>&>(mat);
-		n_clusters = (*clustering)(distances, objects, threshold, assignments);
+	if (params.dendrogramInput.empty()) {
+		LOG_NORMAL << "Clustering (algorithm: " << Params::algo2str(params.algo) << ")... ";
 	}
 	else {
-		auto clustering = createClusteringAlgo<mini_dist_t>(params);
-		IMatrix& mat = graph.getMatrix();
-		SparseMatrix<mini_dist_t>& distances = static_cast<SparseMatrix<mini_dist_t>&>(mat);
-		n_clusters = (*clustering)(distances, objects, threshold, assignments);
+		LOG_NORMAL << "Cutting dendrogram... ";
+	}
+
+	auto t = std::chrono::high_resolution_clock::now();
+	
+	// by default all loaded edges are considered
+	std::vector<double> thresholds{ std::nexttoward(std::numeric_limits<double>::max(), 0.0) };
+
+	if (!params.thresholds.empty()) {
+		auto transform = getTransform(params.distanceSpecification);
+		thresholds.clear();
+		for (const auto& th : params.thresholds) {
+			// parse the same way as values in the distances file
+			thresholds.push_back(transform(Conversions::strtod(th.c_str(), nullptr)));
+		}
 	}
+	
+	std::vector<int> n_clusters;
+
+	withDistanceType(params, [&](auto type) {
+		using Distance = typename decltype(type)::type;
+		if (params.dendrogramInput.empty()) {
+			n_clusters = runClustering<Distance>(params, graph, objects, thresholds, assignments);
+		}
+		else {
+			n_clusters = cutDendrogram<Distance>(graph, thresholds, assignments);
+		}
+	});
 
 	auto dt = std::chrono::high_resolution_clock::now() - t;
 	
-	LOG_NORMAL << endl
-		<< "  objects: " << graph.getNumVertices() << ", clusters: " << n_clusters << endl
-		<< "  time [s]: " << chrono::duration<double>(dt).count() << endl;
+	LOG_NORMAL << endl << "  objects: " << graph.getNumVertices();
+	if (params.thresholds.empty()) {
+		LOG_NORMAL << ", clusters: " << n_clusters.front() << endl;
+	}
+	else {
+		LOG_NORMAL << endl;
+		for (size_t i = 0; i < params.thresholds.size(); ++i) {
+			LOG_NORMAL << "  threshold " << params.thresholds[i] << ", clusters: " << n_clusters[i] << endl;
+		}
+	}
+	LOG_NORMAL << "  time [s]: " << chrono::duration<double>(dt).count() << endl;
 }
 
 // *******************************************************************************************
@@ -268,20 +312,57 @@ void Console::saveAssignments(
 	const Params& params,
 	const Graph& graph,
 	const std::vector<std::string_view>& names,
-	const std::vector<int>& assignments) {
+	const std::vector<std::vector<int>>& assignments) {
 
 	LOG_NORMAL << "Saving clusters (representatives = " << std::boolalpha << params.outputRepresentatives << ")... ";
 	auto t = std::chrono::high_resolution_clock::now();
 
 	char sep = params.outputCSV ? ',' : '\t';
 
-	ofstream ofs(params.output, ios_base::binary);
-	int n_total_clusters = 0;
+	// graph without edges has no assignments
+	size_t n_outputs = std::max<size_t>(1, params.thresholds.size());
+	std::vector<int> no_assignments;
 	
-	n_total_clusters = graph.saveAssignments(ofs, names, assignments, sep, params.outputRepresentatives);
+	LOG_NORMAL << endl;
 	
+	for (size_t i = 0; i < n_outputs; ++i) {
+		std::string fileName = params.thresholds.empty() ? params.output : params.output + "." + params.thresholds[i];
+		
+		ofstream ofs(fileName, ios_base::binary);
+		int n_total_clusters = graph.saveAssignments(ofs, names, i < assignments.size() ? assignments[i] : no_assignments, 
+			sep, params.outputRepresentatives);
+
+		LOG_NORMAL << "  total clusters (including singletons)";
+		if (!params.thresholds.empty()) {
+			LOG_NORMAL << " in " << fileName;
+		}
+		LOG_NORMAL << ": " << n_total_clusters << endl;
+	}
+
 	auto dt = std::chrono::high_resolution_clock::now() - t;
-	LOG_NORMAL << endl
-		<< "  total clusters (including singletons): " << n_total_clusters << endl
-		<< "  time [s]: " << chrono::duration<double>(dt).count() << endl;
-}
\ No newline at end of file
+	LOG_NORMAL << "  time [s]: " << chrono::duration<double>(dt).count() << endl;
+}
+// *******************************************************************************************
+void Console::saveDendrogram(
+	const Params& params,
+	const Graph& graph,
+	const std::vector<std::string_view>& names) {
+
+	if (!params.needDendrogram()) {
+		return;
+	}
+
+	LOG_NORMAL << "Saving dendrogram... ";
+	auto t = std::chrono::high_resolution_clock::now();
+
+	if (!params.dendrogramOutput.empty()) {
+		graph.saveDendrogram(params.dendrogramOutput, dendrogram);
+	}
+
+	if (!params.newickOutput.empty()) {
+		graph.saveNewick(params.newickOutput, names, dendrogram);
+	}
+
+	auto dt = std::chrono::high_resolution_clock::now() - t;
+	LOG_NORMAL << endl << "  time [s]: " << chrono::duration<double>(dt).count() << endl;
+}
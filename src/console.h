@@ -10,9 +10,10 @@
 #include "graph.h"
 
 #include "linkage_heaptrix.h"
+#include "linkage_rnn.h"
 #include "uclust.h"
 #include "set_cover.h"
-#include "single_bfs.h"
+#include "single_union_find.h"
 #include "cd_hit.h"
 #include "leiden.h"
 #include "chunked_vector.h"
@@ -20,12 +21,16 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <type_traits>
+#include <algorithm>
 
 class Console {
 	Params params;
 
 	chunked_vector<char> namesBuffer{ 16LL << 20 }; // 16MB chunk size
 
+	std::vector<node_t> dendrogram;
+
 public:		
 	bool init(int argc, char** argv, Params& params);
 	
@@ -41,18 +46,114 @@ public:
 		const Params& params,
 		Graph& graph,
 		const std::vector<int>& objects,
-		std::vector<int>& assignments);
+		std::vector<std::vector<int>>& assignments);
 
 	void saveAssignments(
 		const Params& params,
 		const Graph& graph,
 		const std::vector<std::string_view>& names,
-		const std::vector<int>& assignments);
+		const std::vector<std::vector<int>>& assignments);
+
+	void saveDendrogram(
+		const Params& params,
+		const Graph& graph,
+		const std::vector<std::string_view>& names);
 
 protected:
 
-	bool needDistances(Algo algo) const { 
-		return (algo == Algo::CompleteLinkage || algo == Algo::Leiden || algo == Algo::UClust);
+	bool needDistances(const Params& params) const { 
+		// thresholds sweep and dendrograms require distances for all algorithms
+		return (params.algo == Algo::CompleteLinkage || params.algo == Algo::AverageLinkage || params.algo == Algo::WeightedLinkage 
+			|| params.algo == Algo::Leiden || params.algo == Algo::UClust)
+			|| !params.thresholds.empty() || params.needDendrogram() || !params.dendrogramInput.empty();
+	}
+
+	// Invokes f with std::type_identity of the distance type used for storing the graph.
+	template <class F>
+	void withDistanceType(const Params& params, F f) const {
+		if (!needDistances(params)) {
+			f(std::type_identity<mini_dist_t>());
+		}
+		else if (params.distancePrecision == DistancePrecision::Float) {
+			f(std::type_identity<float_dist_t>());
+		}
+		else if (params.distancePrecision == DistancePrecision::Fixed16) {
+			f(std::type_identity<fixed_dist_t>());
+		}
+		else {
+			f(std::type_identity<dist_t>());
+		}
+	}
+
+	distance_transformation_t getTransform(DistanceSpecification spec) const {
+		switch (spec) {
+		case DistanceSpecification::Similarity:			return [](double d) { return 1.0 - d; };
+		case DistanceSpecification::PercentSimilarity:	return [](double d) { return 1.0 - d * 0.01; };
+		default:										return [](double d) { return d; };
+		}
+	}
+
+	template <class Distance>
+	std::vector<int> runClustering(
+		const Params& params,
+		Graph& graph,
+		const std::vector<int>& objects,
+		const std::vector<double>& thresholds,
+		std::vector<std::vector<int>>& assignments) {
+		
+		auto clustering = createClusteringAlgo<Distance>(params);
+		SparseMatrix<Distance>& distances = static_cast<SparseMatrix<Distance>&>(graph.getMatrix());
+
+		auto hierarchical = params.needDendrogram() ? dynamic_cast<HierarchicalClustering<Distance>*>(clustering.get()) : nullptr;
+		if (hierarchical) {
+			hierarchical->setKeepDendrogram(true);
+		}
+
+		// round thresholds the same way as stored distances
+		std::vector<double> quantized(thresholds.size());
+		std::transform(thresholds.begin(), thresholds.end(), quantized.begin(), Distance::quantize);
+
+		std::vector<int> n_clusters;
+		if (quantized.size() == 1) {
+			assignments.resize(1);
+			n_clusters = { (*clustering)(distances, objects, quantized.front(), assignments.front()) };
+		}
+		else {
+			n_clusters = clustering->clusterThresholds(distances, objects, quantized, assignments);
+		}
+
+		if (hierarchical) {
+			dendrogram = hierarchical->releaseDendrogram();
+		}
+
+		return n_clusters;
+	}
+
+	template <class Distance>
+	std::vector<int> cutDendrogram(
+		const Graph& graph,
+		const std::vector<double>& thresholds,
+		std::vector<std::vector<int>>& assignments) {
+
+		std::vector<int> n_clusters(thresholds.size());
+		assignments.assign(thresholds.size(), std::vector<int>(graph.getNumVertices()));
+
+		for (size_t i = 0; i < thresholds.size(); ++i) {
+			n_clusters[i] = HierarchicalClustering<Distance>::dendrogramToAssignments(
+				dendrogram, Distance::quantize(thresholds[i]), assignments[i]);
+		}
+
+		return n_clusters;
+	}
+
+	template <template <class, class> class Heaptrix, class Distance>
+	std::unique_ptr<IClustering<Distance>> createHeaptrix(const Params& params) {
+		if (params.linkageHeap == LinkageHeap::Bucket) {
+			return std::make_unique<Heaptrix<Distance, linkage_algorithm_heaptrix::bucket_heap_policy>>(params.numThreads);
+		}
+		else {
+			return std::make_unique<Heaptrix<Distance, linkage_algorithm_heaptrix::binary_heap_policy>>(params.numThreads);
+		}
 	}
 
 	template <class Distance>
@@ -64,9 +165,38 @@ protected:
 		{
 			
 		case Algo::SingleLinkage:
-			clustering = std::make_unique<SingleLinkageBFS<Distance>>(); break;
+			// union-find does not build a dendrogram
+			if (params.needDendrogram()) {
+				clustering = createHeaptrix<SingleLinkage, Distance>(params);
+			}
+			else {
+				clustering = std::make_unique<SingleLinkageUnionFind<Distance>>(params.numThreads);
+			}
+			break;
 		case Algo::CompleteLinkage:
-			clustering = std::make_unique<CompleteLinkage<Distance>>(); break;
+			if (params.linkageEngine == LinkageEngine::RNN) {
+				clustering = std::make_unique<CompleteLinkageRNN<Distance>>(params.numThreads);
+			}
+			else {
+				clustering = createHeaptrix<CompleteLinkage, Distance>(params);
+			}
+			break;
+		case Algo::AverageLinkage:
+			if (params.linkageEngine == LinkageEngine::RNN) {
+				clustering = std::make_unique<AverageLinkageRNN<Distance>>(params.numThreads);
+			}
+			else {
+				clustering = createHeaptrix<AverageLinkage, Distance>(params);
+			}
+			break;
+		case Algo::WeightedLinkage:
+			if (params.linkageEngine == LinkageEngine::RNN) {
+				clustering = std::make_unique<WeightedLinkageRNN<Distance>>(params.numThreads);
+			}
+			else {
+				clustering = createHeaptrix<WeightedLinkage, Distance>(params);
+			}
+			break;
 		case Algo::UClust:
 			clustering = std::make_unique<UClust<Distance>>(); break;
 		case Algo::SetCover:
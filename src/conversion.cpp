@@ -11,4 +11,5 @@
 char Conversions::digits[100000 * 5];
 uint64_t Conversions::powers10[15];
 double Conversions::neg_powers10[15];
-Conversions::_si Conversions::_init;
\ No newline at end of file
+double Conversions::frac_multipliers[Conversions::MAX_SWAR_DOUBLE_DIGITS + 1];
+Conversions::_si Conversions::_init;
@@ -16,6 +16,7 @@
 #include <cctype>
 #include <limits>
 #include <cmath>
+#include <bit>
 
 #include <iostream>
 #include <iomanip>
@@ -54,6 +55,11 @@ public:
 				powers10[i] = 10 * powers10[i - 1];
 				neg_powers10[i] = 0.1 * neg_powers10[i - 1];
 			}
+
+			frac_multipliers[0] = 1.0;
+			for (int i = 1; i <= MAX_SWAR_DOUBLE_DIGITS; ++i) {
+				frac_multipliers[i] = frac_multipliers[i - 1] * 0.1;
+			}
 		}
 	} static _init;
 
@@ -139,7 +145,121 @@ public:
 	}
 
 
+	static const int MAX_SWAR_DOUBLE_DIGITS = 15;
+	static const int MAX_SWAR_LONG_DIGITS = sizeof(long int) == 8 ? 18 : 9;
+
+	// products of consecutive multiplications by 0.1 (as in the scalar conversion)
+	static double frac_multipliers[MAX_SWAR_DOUBLE_DIGITS + 1];
+
+	static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+	// Returns the number of leading decimal digits among 8 bytes at p and stores their value. 
+	static int parse_eight_digits(const char* p, uint64_t& value) {
+		uint64_t x;
+		std::memcpy(&x, p, 8);
+		x ^= 0x3030303030303030ULL;	// digits become bytes 0..9
+
+		// the highest bit of a byte is set when it is not a digit (no carries between bytes)
+		uint64_t non_digits = (x | ((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL)) & 0x8080808080808080ULL;
+		int n = non_digits ? std::countr_zero(non_digits) / 8 : 8;
+		if (n == 0) {
+			value = 0;
+			return 0;
+		}
+
+		// move digits to the least significant positions (preceded by zeros) and combine them pairwise
+		x <<= 8 * (8 - n);
+		x = (x * 10) + (x >> 8);
+		x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+		value = x;
+		return n;
+	}
+
+	// Parses up to 16 digits at p (advancing it) from two 8-byte words converted independently. 
+	// Returns false when there are more than max_digits digits, the platform is not little-endian, 
+	// or the words could cross a memory page. 
+	static bool parse_digits_swar(const char*& p, int max_digits, uint64_t& value, int& n_digits) {
+		if constexpr (std::endian::native != std::endian::little) {
+			return false;
+		}
+
+		if (((uintptr_t)p & 4095) > 4096 - 16) {
+			return false;
+		}
+
+		uint64_t v1, v2;
+		int n1 = parse_eight_digits(p, v1);
+		int n2 = parse_eight_digits(p + 8, v2);
+
+		if (n1 < 8) {
+			value = v1;
+			n_digits = n1;
+		}
+		else {
+			n_digits = 8 + n2;
+			if (n_digits > max_digits || n2 == 8) {
+				return false;
+			}
+			value = v1 * powers10[n2] + v2;
+		}
+
+		p += n_digits;
+		return true;
+	}
+
+	// Applies optional exponential part at p (advancing it).
+	static double apply_exponent(char*& p, double r) {
+		if (*p == 'e' || *p == 'E') {
+			
+			++p;
+			int exp = 0;
+			bool exp_neg = false;
+
+			if (*p == '-') {
+				exp_neg = true;
+				++p;
+			}
+
+			while (*p >= '0' && *p <= '9') {
+				exp = exp * 10 + (*p++ - '0');
+			}
+			
+			if (exp < POWERS_SIZE) {
+				r *= exp_neg ? neg_powers10[exp] : powers10[exp];
+			}
+			else {
+				r *= exp_neg ? pow(10, -exp) : pow(10, exp);
+			}
+		}
+
+		return r;
+	}
+
+	// Parses an integer. Up to 8 digits are converted at once (SWAR), longer numbers 
+	// (possibly overflowing) are handled by the scalar version.
 	static long int strtol(const char* str, char** endptr) {
+		const char* p = str;
+		bool is_negative = false;
+
+		if (*p == '-')
+		{
+			is_negative = true;
+			++p;
+		}
+
+		uint64_t val;
+		int n_digits;
+		if (!parse_digits_swar(p, MAX_SWAR_LONG_DIGITS, val, n_digits)) {
+			return strtol_scalar(str, endptr);
+		}
+
+		if (endptr)
+			*endptr = (char*)p;
+
+		return is_negative ? -(long int)val : (long int)val;
+	}
+
+	static long int strtol_scalar(const char* str, char** endptr) {
 		long int val = 0;
 		char* p = (char*)str;
 		bool is_negative = false;
@@ -162,8 +282,53 @@ public:
 		return is_negative ? -val : val;
 	}
 
-
+	// Parses a floating point number with the same result as the scalar version. Integer and 
+	// fractional parts of up to 15 digits are converted 8 digits at once (SWAR) - they are exact 
+	// in doubles, thus only the final scaling has to be done as in the scalar version.
 	static double strtod(const char* str, char** endptr) {
+		const char* p = str;
+		bool neg = false;
+		if (*p == '-') {
+			neg = true;
+			++p;
+		}
+
+		uint64_t int_part;
+		int n_digits;
+
+		// single-digit integer parts (typical for distances) are not worth a word
+		if (is_digit(p[0]) && !is_digit(p[1])) {
+			int_part = *p++ - '0';
+		}
+		else if (!parse_digits_swar(p, MAX_SWAR_DOUBLE_DIGITS, int_part, n_digits)) {
+			return strtod_scalar(str, endptr);
+		}
+
+		double r = (double)int_part;
+		if (*p == '.') {
+			++p;
+			uint64_t frac_part;
+			if (!parse_digits_swar(p, MAX_SWAR_DOUBLE_DIGITS, frac_part, n_digits)) {
+				return strtod_scalar(str, endptr);
+			}
+			r += (double)frac_part * frac_multipliers[n_digits];
+		}
+
+		char* q = (char*)p;
+		r = apply_exponent(q, r);
+
+		if (neg) {
+			r = -r;
+		}
+
+		if (endptr) {
+			*endptr = q;
+		}
+
+		return r;
+	}
+
+	static double strtod_scalar(const char* str, char** endptr) {
 		char* p = (char*)str;
 		double r = 0.0;
 		bool neg = false;
@@ -190,29 +355,7 @@ public:
 			r += f * mul;
 		}
 
-		// optional exponential part
-		if (*p == 'e' || *p == 'E') {
-			
-			++p;
-			int exp = 0;
-			bool exp_neg = false;
-
-			if (*p == '-') {
-				exp_neg = true;
-				++p;
-			}
-
-			while (*p >= '0' && *p <= '9') {
-				exp = exp * 10 + (*p++ - '0');
-			}
-			
-			if (exp < POWERS_SIZE) {
-				r *= exp_neg ? neg_powers10[exp] : powers10[exp];
-			}
-			else {
-				r *= exp_neg ? pow(10, -exp) : pow(10, exp);
-			}
-		}
+		r = apply_exponent(p, r);
 
 		if (neg) {
 			r = -r;
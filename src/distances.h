@@ -14,6 +14,7 @@
 #include <fstream>
 #include <cstdint>
 #include <functional>
+#include <cmath>
 
 
 /*********************************************************************************************************************/
@@ -27,29 +28,102 @@ class dist_t {
 	uint32_t id;	// object identifier
 
 public:
+	static const bool HAS_DISTANCE = true;
+
 	dist_t() : d(std::numeric_limits<double>::max()), id(0) {}
 	dist_t(uint32_t id, double d) : d(d), id(id) {}
 
 	double get_d() const { return d; }
 	uint32_t get_id() const { return id; }
 
+	static double quantize(double d) { return d; }
+
+	// Checks whether a distance is stored without clamping.
+	static bool in_range(double d) { return true; }
+
 	bool operator<(const dist_t& rhs) const {
 		return (id == rhs.id) ? (d < rhs.d) : (id < rhs.id);
 	}
 };
 #pragma pack(pop)
 
+/*********************************************************************************************************************/
+class float_dist_t {
+
+	float d;		// distance (infinity if not set)
+	uint32_t id;	// object identifier
+
+public:
+	static const bool HAS_DISTANCE = true;
+
+	float_dist_t() : d(std::numeric_limits<float>::infinity()), id(0) {}
+	float_dist_t(uint32_t id, double d) : d((float)d), id(id) {}
+
+	double get_d() const { return d; }
+	uint32_t get_id() const { return id; }
+
+	// Returns value as it would be stored (thresholds have to be rounded the same way as distances).
+	static double quantize(double d) { return (d < std::numeric_limits<float>::max()) ? (double)(float)d : d; }
+
+	static bool in_range(double d) { return true; }
+
+	bool operator<(const float_dist_t& rhs) const {
+		return (id == rhs.id) ? (d < rhs.d) : (id < rhs.id);
+	}
+};
+
+/*********************************************************************************************************************/
+// Distance from [0,1] interval quantized to 16 bits. Larger distances saturate at 1.
+#pragma pack(push, 2)
+class fixed_dist_t {
+
+	static constexpr uint16_t INF_CODE = std::numeric_limits<uint16_t>::max();
+	static constexpr double SCALE = INF_CODE - 1;
+
+	uint16_t code;	// quantized distance
+	uint32_t id;	// object identifier
+
+	static uint16_t encode(double d) {
+		return (d >= std::numeric_limits<float>::max()) ? INF_CODE : (uint16_t)std::lround(std::clamp(d, 0.0, 1.0) * SCALE);
+	}
+
+public:
+	static const bool HAS_DISTANCE = true;
+
+	fixed_dist_t() : code(INF_CODE), id(0) {}
+	fixed_dist_t(uint32_t id, double d) : code(encode(d)), id(id) {}
+
+	double get_d() const { return (code == INF_CODE) ? std::numeric_limits<double>::infinity() : code / SCALE; }
+	uint32_t get_id() const { return id; }
+
+	static double quantize(double d) { return (d <= 1.0) ? fixed_dist_t(0, d).get_d() : d; }
+
+	// Distances outside [0,1] (except unset ones) are clamped by encode().
+	static bool in_range(double d) { return (d >= 0.0 && d <= 1.0) || d >= std::numeric_limits<float>::max(); }
+
+	bool operator<(const fixed_dist_t& rhs) const {
+		return (id == rhs.id) ? (code < rhs.code) : (id < rhs.id);
+	}
+};
+#pragma pack(pop)
+
 /*********************************************************************************************************************/
 class mini_dist_t {
 	uint32_t id;	// object identifier
 
 public:
+	static const bool HAS_DISTANCE = false;
+
 	mini_dist_t() : id(0) {}
 	mini_dist_t(uint32_t id, double d) : id(id) {}
 
 	double get_d() const { return 0.0; } // mini_dist_t is always below threshold
 	uint32_t get_id() const { return id; }
 
+	static double quantize(double d) { return d; }
+
+	static bool in_range(double d) { return true; }
+
 	bool operator<(const mini_dist_t& rhs) const {
 		return (id < rhs.id);
 	}
@@ -49,13 +49,12 @@ void Graph::sortClustersBySize(
 
 /*********************************************************************************************************************/
 void Graph::processHeader(
-	std::ifstream& ifs,
+	const std::string& header,
 	const std::pair<std::string, std::string>& idColumns,
 	const std::string& distanceColumn,
 	const std::map<std::string, ColumnFilter>& columns2filters) {
 
-	std::string line;
-	std::getline(ifs, line);
+	std::string line = header;
 
 	std::replace(line.begin(), line.end(), ',', ' ');
 	std::istringstream iss(line);
@@ -106,5 +105,23 @@ void Graph::processHeader(
 	this->distanceColumnId = col_distance;
 	this->sequenceColumnIds[0] = col_ids[0];
 	this->sequenceColumnIds[1] = col_ids[1];
+
+	// id columns take precedence over distance and filters
+	this->columnActions.assign(columns.size(), ColumnAction::Skip);
+	for (int c = 0; c < n_columns; ++c) {
+		if (filters[c].enabled) {
+			columnActions[c] = ColumnAction::Filter;
+		}
+	}
+	columnActions[col_distance] = ColumnAction::Distance;
+	columnActions[col_ids[0]] = ColumnAction::FirstId;
+	columnActions[col_ids[1]] = ColumnAction::SecondId;
+
+	this->lastNeededColumn = 0;
+	for (int c = 0; c < n_columns; ++c) {
+		if (columnActions[c] != ColumnAction::Skip) {
+			lastNeededColumn = c;
+		}
+	}
 }
 
@@ -7,6 +7,7 @@
 // *******************************************************************************************
 #pragma once
 #include "distances.h"
+#include "clustering.h"
 
 #include <vector>
 #include <limits>
@@ -14,6 +15,14 @@
 #include <cstring>
 #include <map>
 #include <tuple>
+#include <cstdint>
+
+// *******************************************************************************************/
+enum class InputMode {
+	Stream,		// loader thread reads consecutive blocks into buffers
+	Mapped,		// parsers work directly on memory-mapped file, no loader thread
+	Parallel	// parsers read disjoint ranges of the file with positional reads, no loader thread
+};
 
 // *******************************************************************************************/
 struct ColumnFilter {
@@ -22,6 +31,16 @@ struct ColumnFilter {
 	bool enabled{ false };
 };
 
+// *******************************************************************************************/
+// What a parser does with a column of the distances table
+enum class ColumnAction : uint8_t {
+	Skip,
+	FirstId,
+	SecondId,
+	Distance,
+	Filter
+};
+
 // *******************************************************************************************/
 class IEdgesCollection {
 public:
@@ -60,6 +79,11 @@ protected:
 
 	std::vector<ColumnFilter> filters;
 
+	// per-column actions precomputed from the header; parsers stop at the last needed column
+	std::vector<ColumnAction> columnActions;
+
+	int lastNeededColumn{ 2 };
+
 public:
 	static bool isSeparator(char c) { return c == ',' || c == '\t' || c == '\r' || c == '\n'; }
 	static bool isNewline(char c) { return c == '\r' || c == '\n'; }
@@ -77,12 +101,41 @@ public:
 	virtual size_t getNumEdges() const = 0;
 		
 	virtual size_t load(
-		std::ifstream& ifs,
+		const std::string& fileName,
+		InputMode inputMode,
 		const std::pair<std::string, std::string>& idColumns,
 		const std::string& distanceColumn,
 		distance_transformation_t transform,
 		const std::map<std::string, ColumnFilter>& columns2filters) = 0;
 
+	// Enables storing every edge once (must be set before loading).
+	virtual void setHalfMatrix(bool half) = 0;
+
+	// Builds only connected components while loading, edges are not stored (must be set before loading).
+	virtual void setStreaming(bool streaming) = 0;
+
+	// Configures histogram of distances computed after loading in the verbose mode or when a file is given 
+	// (bins of a given width starting at 0, preceded by a bin of negative values and followed by a bin of the remaining ones).
+	virtual void setHistogram(double binWidth, int numBins, const std::string& fileName) = 0;
+
+	// Stores filtered graph in a binary form (see graph_file.h).
+	virtual void saveBinary(const std::string& fileName) const = 0;
+
+	// Loads graph stored by saveBinary. Returns the number of input edges.
+	virtual size_t loadBinary(const std::string& fileName) = 0;
+
+	// Stores dendrogram of graph vertices in a binary form (see graph_file.h).
+	virtual void saveDendrogram(const std::string& fileName, const std::vector<node_t>& dendrogram) const = 0;
+
+	// Loads dendrogram stored by saveDendrogram. Graph gets vertices without edges.
+	virtual void loadDendrogram(const std::string& fileName, std::vector<node_t>& dendrogram) = 0;
+
+	// Stores dendrogram as a forest in the Newick format (one tree per line).
+	virtual void saveNewick(
+		const std::string& fileName, 
+		const std::vector<std::string_view>& externalNames,
+		const std::vector<node_t>& dendrogram) const = 0;
+
 	virtual int saveAssignments(
 		std::ofstream& ofs,
 		const std::vector<std::string_view>& externalNames,
@@ -101,7 +154,7 @@ public:
 protected:
 
 	void processHeader(
-		std::ifstream& ifs,
+		const std::string& header,
 		const std::pair<std::string, std::string>& idColumns,
 		const std::string& distanceColumn,
 		const std::map<std::string, ColumnFilter>& columns2filters);
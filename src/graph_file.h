@@ -0,0 +1,244 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include "mapped_file.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+
+// *******************************************************************************************
+// Binary graph file (.clg) with a filtered graph in the CSR form. The file is mapped back
+// into memory, so no parsing is needed. Sections are aligned to 8 bytes, integers are stored
+// in the native byte order:
+//   header				GraphFileHeader
+//   row offsets		uint64_t[numRows + 1]
+//   neighbour ids		uint32_t[numElements]
+//   distances			double[numElements] (only with FLAG_DISTANCES)
+//   mappings			zero-terminated names (named graphs) or int32_t[numRows] global ids
+// *******************************************************************************************
+struct GraphFileHeader {
+	static constexpr char MAGIC[8]{ 'C', 'L', 'U', 'S', 'T', 'Y', 'G', 0 };
+	static const uint32_t VERSION = 1;
+
+	static const uint32_t FLAG_NAMED = 1;
+	static const uint32_t FLAG_DISTANCES = 2;
+	static const uint32_t FLAG_HALF = 4;		// every edge stored once (in the row of the smaller vertex)
+
+	char magic[8]{ 'C', 'L', 'U', 'S', 'T', 'Y', 'G', 0 };
+	uint32_t version{ VERSION };
+	uint32_t flags{ 0 };
+	uint64_t numRows{ 0 };
+	uint64_t numElements{ 0 };
+	uint64_t numInputEdges{ 0 };
+
+	static size_t align(size_t v) { return (v + 7) / 8 * 8; }
+
+	bool isNamed() const { return flags & FLAG_NAMED; }
+	bool hasDistances() const { return flags & FLAG_DISTANCES; }
+	bool isHalf() const { return flags & FLAG_HALF; }
+
+	size_t offsetsPos() const { return sizeof(GraphFileHeader); }
+	size_t idsPos() const { return offsetsPos() + sizeof(uint64_t) * (numRows + 1); }
+	size_t distancesPos() const { return idsPos() + align(sizeof(uint32_t) * numElements); }
+	size_t mappingsPos() const { return distancesPos() + (hasDistances() ? sizeof(double) * numElements : 0); }
+
+	void check() const {
+		if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw std::runtime_error("Not a Clusty graph file");
+		}
+		if (version != VERSION) {
+			throw std::runtime_error("Unsupported version of a graph file");
+		}
+	}
+
+	static GraphFileHeader read(const std::string& fileName) {
+		GraphFileHeader header;
+		std::ifstream ifs(fileName, std::ios_base::binary);
+		if (!ifs) {
+			throw std::runtime_error("Unable to open graph file");
+		}
+
+		ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!ifs) {
+			throw std::runtime_error("Not a Clusty graph file");
+		}
+
+		header.check();
+		return header;
+	}
+};
+
+
+// *******************************************************************************************
+// Binary dendrogram file (.cld) with merges of a hierarchical clustering. Sections are aligned 
+// to 8 bytes, integers are stored in the native byte order:
+//   header				DendrogramFileHeader
+//   merges				DendrogramFileNode[numMerges] (ids below numObjects are objects,
+//						id numObjects + k is a group created by k-th merge)
+//   mappings			zero-terminated names (named graphs) or int32_t[numObjects] global ids
+// *******************************************************************************************
+struct DendrogramFileNode {
+	int32_t first;
+	int32_t second;
+	double distance;
+};
+
+struct DendrogramFileHeader {
+	static constexpr char MAGIC[8]{ 'C', 'L', 'U', 'S', 'T', 'Y', 'D', 0 };
+	static const uint32_t VERSION = 1;
+
+	static const uint32_t FLAG_NAMED = 1;
+
+	char magic[8]{ 'C', 'L', 'U', 'S', 'T', 'Y', 'D', 0 };
+	uint32_t version{ VERSION };
+	uint32_t flags{ 0 };
+	uint64_t numObjects{ 0 };
+	uint64_t numMerges{ 0 };
+
+	bool isNamed() const { return flags & FLAG_NAMED; }
+
+	size_t mergesPos() const { return sizeof(DendrogramFileHeader); }
+	size_t mappingsPos() const { return mergesPos() + sizeof(DendrogramFileNode) * numMerges; }
+
+	void check() const {
+		if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw std::runtime_error("Not a Clusty dendrogram file");
+		}
+		if (version != VERSION) {
+			throw std::runtime_error("Unsupported version of a dendrogram file");
+		}
+	}
+
+	static DendrogramFileHeader read(const std::string& fileName) {
+		DendrogramFileHeader header;
+		std::ifstream ifs(fileName, std::ios_base::binary);
+		if (!ifs) {
+			throw std::runtime_error("Unable to open dendrogram file");
+		}
+
+		ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!ifs) {
+			throw std::runtime_error("Not a Clusty dendrogram file");
+		}
+
+		header.check();
+		return header;
+	}
+};
+
+
+// *******************************************************************************************
+// Binary file opened for reading. The memory stays valid as long as the object exists
+// (names of a named graph point directly to the mapping).
+// *******************************************************************************************
+template <class Header>
+class BinaryFile {
+	MappedFile mappedFile;
+	std::vector<char> buffer; // used when mapping is not supported
+
+protected:
+	const char* base{ nullptr };
+	size_t fileSize{ 0 };
+
+public:
+	Header header;
+
+	void open(const std::string& fileName) {
+		if (MappedFile::SUPPORTED) {
+			if (!mappedFile.open(fileName)) {
+				throw std::runtime_error("Unable to open file " + fileName);
+			}
+			base = mappedFile.data();
+			fileSize = mappedFile.size();
+		}
+		else {
+			std::ifstream ifs(fileName, std::ios_base::binary | std::ios_base::ate);
+			if (!ifs) {
+				throw std::runtime_error("Unable to open file " + fileName);
+			}
+			buffer.resize((size_t)ifs.tellg());
+			ifs.seekg(0);
+			ifs.read(buffer.data(), buffer.size());
+			base = buffer.data();
+			fileSize = buffer.size();
+		}
+
+		if (fileSize < sizeof(Header)) {
+			throw std::runtime_error("Not a Clusty file: " + fileName);
+		}
+
+		memcpy(&header, base, sizeof(Header));
+		header.check();
+
+		if (fileSize < header.mappingsPos()) {
+			throw std::runtime_error("Truncated file: " + fileName);
+		}
+	}
+
+	const char* mappings() const { return base + header.mappingsPos(); }
+	size_t mappingsSize() const { return fileSize - header.mappingsPos(); }
+};
+
+
+// *******************************************************************************************
+class GraphFile : public BinaryFile<GraphFileHeader> {
+public:
+	const uint64_t* offsets() const { return reinterpret_cast<const uint64_t*>(base + header.offsetsPos()); }
+	const uint32_t* ids() const { return reinterpret_cast<const uint32_t*>(base + header.idsPos()); }
+	const double* distances() const { return reinterpret_cast<const double*>(base + header.distancesPos()); }
+};
+
+
+// *******************************************************************************************
+class DendrogramFile : public BinaryFile<DendrogramFileHeader> {
+public:
+	const DendrogramFileNode* merges() const { return reinterpret_cast<const DendrogramFileNode*>(base + header.mergesPos()); }
+};
+
+
+// *******************************************************************************************
+// Writes consecutive sections of a binary file padding them to 8 bytes.
+// *******************************************************************************************
+class GraphFileWriter {
+	std::ofstream ofs;
+	std::vector<char> filebuf;
+
+public:
+	GraphFileWriter(const std::string& fileName) : filebuf(16ULL << 20) {
+		ofs.rdbuf()->pubsetbuf(filebuf.data(), filebuf.size());
+		ofs.open(fileName, std::ios_base::binary);
+		if (!ofs) {
+			throw std::runtime_error("Unable to create file " + fileName);
+		}
+	}
+
+	template <class T>
+	void write(const T* data, size_t count) {
+		ofs.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+	}
+
+	void pad() {
+		const char zeros[8]{ 0 };
+		size_t pos = (size_t)ofs.tellp();
+		ofs.write(zeros, GraphFileHeader::align(pos) - pos);
+	}
+
+	void close() {
+		ofs.close();
+		if (!ofs) {
+			throw std::runtime_error("Error writing binary file");
+		}
+	}
+};
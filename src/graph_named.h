@@ -7,13 +7,12 @@
 // *******************************************************************************************
 #pragma once
 #include "graph_sparse.h"
-#include "hasher.h"
+#include "separator_index.h"
+#include "name_dictionary.h"
 #include "io.h"
-#include "chunked_vector.h"
 
 #include <iostream>
 #include <limits>
-#include <unordered_map>
 #include <vector>
 #include <cstdint>
 #include <string>
@@ -21,6 +20,7 @@
 // *******************************************************************************************/
 union name_or_id_t { 
 	std::string_view name; 
+	NameEntry* entry;
 	int id; 
 	
 	name_or_id_t() : id{0} {}
@@ -32,14 +32,11 @@ using NamedEdgesCollection = EdgesCollection<name_or_id_t>;
 template <class Distance>
 class GraphNamed : public GraphSparse<Distance> {
 
-	using ids_pair_t = std::pair<int, int>;
-
-	std::unordered_map<std::string_view, ids_pair_t, Murmur64_full<std::string_view>> names2ids;
+	// names are resolved to entries by parsers, ids are assigned by the mapper in the block order
+	NameDictionary names2ids;
 
 	std::vector<std::string_view> ids2names;
 
-	chunked_vector<char> namesBuffer{ 16LL << 20 }; // 16MB chunk size
-
 public:
 	GraphNamed(int numThreads) : GraphSparse<Distance>(numThreads) {}
 
@@ -71,13 +68,8 @@ public:
 protected:
 
 	int get_id(const std::string_view& name) const {
-		auto it = names2ids.find(name);
-		if (it == names2ids.end()) {
-			return -1;
-		}
-		else {
-			return it->second.first;
-		}
+		const NameEntry* entry = names2ids.find(name);
+		return entry ? entry->id : -1;
 	}
 	
 	IEdgesCollection* createEdgesCollection(size_t preallocSize) override { 
@@ -103,6 +95,21 @@ protected:
 		int startRow,
 		int stride) override;
 
+	size_t updateComponents(
+		const IEdgesCollection& edges,
+		int part,
+		int n_parts) override;
+
+	bool isNamed() const override { return true; }
+
+	void saveMappings(GraphFileWriter& writer) const override;
+
+	void loadMappings(const char* data, size_t size) override;
+
+	std::string getVertexName(int localId, const std::vector<std::string_view>& externalNames) const override {
+		return std::string(ids2names[localId]);
+	}
+
 };
 
 /*********************************************************************************************************************/
@@ -135,6 +142,14 @@ bool GraphNamed<Distance>::parseBlock(
 	
 	char* line = block_begin;
 
+	// separators of the whole block (buffer reused by the parser thread)
+	thread_local SeparatorIndex index;
+	index.build(block_begin, block_end);
+
+	// consecutive rows often share names (e.g. the first column is sorted)
+	std::string_view lastNames[2];
+	NameEntry* lastEntries[2]{ nullptr, nullptr };
+
 	while (line != block_end) {
 
 		++n_rows;
@@ -143,11 +158,11 @@ bool GraphNamed<Distance>::parseBlock(
 		NamedEdgesCollection::edge_t edge;
 		edge.second = std::numeric_limits<double>::max();
 		bool carryOn = true;
-		int k = 0;
 		bool reachedNewline = false;
 
-		for (int c = 0; c < n_columns; ++c) {
-			char* q = std::find_if(p, block_end, this->isSeparator); // support both tsv and csv files
+		// columns after the last needed one are not scanned
+		for (int c = 0; c <= this->lastNeededColumn; ++c) {
+			char* q = index.next(p); // support both tsv and csv files
 
 			reachedNewline = this->isNewline(*q);
 
@@ -159,16 +174,15 @@ bool GraphNamed<Distance>::parseBlock(
 				*q = 0;
 			}
 
-			size_t name_len = q - p;
+			ColumnAction action = this->columnActions[c];
 
-			if (k < 2 && c == this->sequenceColumnIds[k]) {
-				edge.first[k].name = std::string_view(p, name_len);
-				++k;
+			if (action == ColumnAction::FirstId || action == ColumnAction::SecondId) {
+				edge.first[action == ColumnAction::SecondId].name = std::string_view(p, q - p);
 			}
-			else if (c == this->distanceColumnId || this->filters[c].enabled) {
+			else if (action != ColumnAction::Skip) {
 				double value = Conversions::strtod(p, &p);
 
-				if (c == this->distanceColumnId) {
+				if (action == ColumnAction::Distance) {
 					edge.second = transform(value); 	// convert similarity to distance if neccessary
 				}
 
@@ -186,6 +200,17 @@ bool GraphNamed<Distance>::parseBlock(
 		
 		// do not consider diagonal elements (they are assumed to have 0 distance)
 		if (carryOn && (edge.first[0].name != edge.first[1].name)) {
+			
+			// resolve names to dictionary entries (names are copied, so the block can be released)
+			for (int k = 0; k < 2; ++k) {
+				std::string_view name = edge.first[k].name;
+				if (lastEntries[k] == nullptr || name != lastNames[k]) {
+					lastNames[k] = name;
+					lastEntries[k] = names2ids.insert(name);
+				}
+				edge.first[k].entry = lastEntries[k];
+			}
+			
 			namedEdges.data.push_back(edge);
 		}
 
@@ -196,14 +221,14 @@ bool GraphNamed<Distance>::parseBlock(
 		}
 		else {
 			// find new line character
-			p = std::find_if(p, block_end, this->isNewline);
+			p = index.nextNewline(p);
 		}
 
 		// p should be at symbol right after newline (but new line can consists of two chars)
 		line = std::find_if(p, block_end, [](char c) { return c != '\r' && c != '\n' && c != 0; });
 	}
 
-	return false; // cannot free input buffer
+	return true; // names were copied to the dictionary
 }
 
 
@@ -214,34 +239,18 @@ void GraphNamed<Distance>::updateMappings(
 
 	NamedEdgesCollection& namedEdges{ dynamic_cast<NamedEdgesCollection&>(edges) };
 
+	// blocks come in the input order, thus ids are assigned in the order of first occurrences
 	for (NamedEdgesCollection::edge_t& e : namedEdges.data) {
-
-		decltype(names2ids.begin()) its[2];
-
 		for (int k = 0; k < 2; ++k) {
-			const std::string_view& name = e.first[k].name;
-
-			// store name in hashtable
-			its[k] = names2ids.find(name);
-
-			if (its[k] == names2ids.end()) {
-
-				char* dst = namesBuffer.resize_for_additional(name.size() + 1);
-				std::copy_n(name.data(), name.size(), dst); // 0 is already there						
-				auto it_and_flag = names2ids.insert({ std::string_view(dst, name.size()), {-1, names2ids.size()} }); // -1 indicate singleton
-
-				its[k] = it_and_flag.first;
-			}
-
-			auto it = its[k];
+			NameEntry* entry = e.first[k].entry;
 
 			// if name not mapped to numerical ids
-			if (it->second.first == -1) {
-				ids2names.push_back(it->first);
-				it->second.first = (int)ids2names.size() - 1;
+			if (entry->id == -1) {
+				ids2names.push_back(entry->name);
+				entry->id = (int)ids2names.size() - 1;
 			}
 		
-			e.first[k].id = it->second.first;
+			e.first[k].id = entry->id;
 		}	
 	}
 }
@@ -262,10 +271,16 @@ void GraphNamed<Distance>::updateMatrix(
 
 	const NamedEdgesCollection& namedEdges{ dynamic_cast<const NamedEdgesCollection&>(edges) };
 
+	size_t n_clamped = 0;
 	for (const NamedEdgesCollection::edge_t& e : namedEdges.data) {
 		for (int k = 0; k < 2; ++k) {
 
 			int lid = e.first[k].id;
+			// half matrix stores edges in rows of smaller vertices only
+			if (this->matrix.half_matrix && lid > e.first[k ^ 1].id) {
+				continue;
+			}
+
 			if ((lid % stride) == startRow && e.second < std::numeric_limits<double>::max()) {
 				auto& D = this->matrix.distances[lid];
 
@@ -275,11 +290,73 @@ void GraphNamed<Distance>::updateMatrix(
 				}
 
 				D.emplace_back(e.first[k ^ 1].id, e.second);
+				n_clamped += !Distance::in_range(e.second);
 			}
 		}
 	}
+
+	this->numClampedDistances += n_clamped;
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+size_t GraphNamed<Distance>::updateComponents(
+	const IEdgesCollection& edges,
+	int part,
+	int n_parts) {
+
+	const NamedEdgesCollection& namedEdges{ dynamic_cast<const NamedEdgesCollection&>(edges) };
+	
+	size_t n_edges = namedEdges.data.size();
+	size_t first = n_edges * part / n_parts;
+	size_t last = n_edges * (part + 1) / n_parts;
+	size_t n_processed = 0;
+
+	for (size_t i = first; i < last; ++i) {
+		const auto& e = namedEdges.data[i];
+		if (e.second < std::numeric_limits<double>::max()) {
+			this->matrix.components->unite(e.first[0].id, e.first[1].id);
+			++n_processed;
+		}
+	}
+
+	return n_processed;
+}
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphNamed<Distance>::saveMappings(GraphFileWriter& writer) const {
+	for (const auto& name : ids2names) {
+		writer.write(name.data(), name.size() + 1); // names are zero-terminated
+	}
 }
 
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphNamed<Distance>::loadMappings(const char* data, size_t size) {
+
+	size_t n_names = this->matrix.num_objects();
+	ids2names.clear();
+	ids2names.reserve(n_names);
+	names2ids.clear();
+	names2ids.reserve(n_names);
+
+	// names point directly to the graph file
+	const char* p = data;
+	const char* end = data + size;
+	
+	for (size_t i = 0; i < n_names; ++i) {
+		const char* q = std::find(p, end, 0);
+		if (q == end) {
+			throw std::runtime_error("Truncated object mappings");
+		}
+
+		ids2names.emplace_back(p, q - p);
+		names2ids.insert(ids2names.back(), false)->id = (int)i;
+		p = q + 1;
+	}
+}
 
 /*********************************************************************************************************************/
 template <class Distance>
@@ -377,22 +454,14 @@ void GraphNamed<Distance>::print(std::ostream& out) const {
 
 	out.precision(10);
 
-	std::vector<std::string_view> names(names2ids.size());
-	int i = 0;
-	for (auto q : names2ids) {
-		names[i] = q.first;
-		++i;
-	}
-
+	std::vector<std::string_view> names(ids2names);
 	std::sort(names.begin(), names.end());
 
 	for (auto name : names) {
 		
-		int i = names2ids.at(name).first;
-		const std::vector<Distance>& row = this->matrix.distances[i];
-
-		for (auto& p : row) {
-			out << ids2names[i] << "," << ids2names[p.get_id()] << "," << std::fixed << p.get_d() << std::endl;
+		int i = get_id(name);
+		for (const Distance* p = this->matrix.begin(i); p < this->matrix.end(i); ++p) {
+			out << ids2names[i] << "," << ids2names[p->get_id()] << "," << std::fixed << p->get_d() << std::endl;
 		}
 	}
 }
@@ -7,6 +7,7 @@
 // *******************************************************************************************
 #pragma once
 #include "graph_sparse.h"
+#include "separator_index.h"
 #include "log.h"
 #include "io.h"
 #include "chunked_vector.h"
@@ -94,6 +95,22 @@ protected:
 		int startRow,
 		int stride) override;
 
+	size_t updateComponents(
+		const IEdgesCollection& edges,
+		int part,
+		int n_parts) override;
+
+	bool isNamed() const override { return false; }
+
+	void saveMappings(GraphFileWriter& writer) const override;
+
+	void loadMappings(const char* data, size_t size) override;
+
+	std::string getVertexName(int localId, const std::vector<std::string_view>& externalNames) const override {
+		int gid = local2global[localId];
+		return (gid < (int)externalNames.size()) ? std::string(externalNames[gid]) : std::to_string(gid);
+	}
+
 };
 
 
@@ -125,6 +142,10 @@ bool GraphNumbered<Distance>::parseBlock(
 	n_rows = 0;
 
 	char* line = block_begin;
+
+	// separators of the whole block (buffer reused by the parser thread)
+	thread_local SeparatorIndex index;
+	index.build(block_begin, block_end);
 	
 	int max_value = 0;
 
@@ -133,15 +154,15 @@ bool GraphNumbered<Distance>::parseBlock(
 		++n_rows;
 
 		char* p = line;
-		int k = 0;
 		
 		NumberedEdgesCollection::edge_t edge;
 		edge.second = std::numeric_limits<double>::max();
 		bool carryOn = true;
 		bool reachedNewline = false;
 
-		for (int c = 0; c < n_columns; ++c) {
-			char* q = std::find_if(p, block_end, this->isSeparator); // support both tsv and csv files
+		// columns after the last needed one are not scanned
+		for (int c = 0; c <= this->lastNeededColumn; ++c) {
+			char* q = index.next(p); // support both tsv and csv files
 		
 			reachedNewline = this->isNewline(*q);
 
@@ -152,14 +173,15 @@ bool GraphNumbered<Distance>::parseBlock(
 				*q = 0;
 			}
 
-			if (k < 2 && c == this->sequenceColumnIds[k]) {
-				edge.first[k] = Conversions::strtol(p, nullptr);
-				++k;
+			ColumnAction action = this->columnActions[c];
+
+			if (action == ColumnAction::FirstId || action == ColumnAction::SecondId) {
+				edge.first[action == ColumnAction::SecondId] = Conversions::strtol(p, nullptr);
 			}
-			else if (c == this->distanceColumnId || this->filters[c].enabled) {
+			else if (action != ColumnAction::Skip) {
 				double value = Conversions::strtod(p, nullptr);
 
-				if (c == this->distanceColumnId) {
+				if (action == ColumnAction::Distance) {
 					edge.second = transform(value); 	// convert similarity to distance if neccessary
 				}
 
@@ -196,7 +218,7 @@ bool GraphNumbered<Distance>::parseBlock(
 		}
 		else {
 			// find new line character
-			p = std::find_if(p, block_end, this->isNewline);
+			p = index.nextNewline(p);
 		}
 		
 		// p should be at symbol right after newline (but new line can consists of two chars)
@@ -261,11 +283,17 @@ void GraphNumbered<Distance>::updateMatrix(
 
 	const NumberedEdgesCollection& numberedEdges{ dynamic_cast<const NumberedEdgesCollection&>(edges) };
 
+	size_t n_clamped = 0;
 	for (const NumberedEdgesCollection::edge_t& e : numberedEdges.data) {
 
 		for (int k = 0; k < 2; ++k) {
 			int lid = e.first[k];
 
+			// half matrix stores edges in rows of smaller vertices only
+			if (this->matrix.half_matrix && lid > e.first[k ^ 1]) {
+				continue;
+			}
+
 			if ((lid % stride) == startRow && e.second < std::numeric_limits<double>::max()) {
 				auto& D = this->matrix.distances[lid];
 				
@@ -275,11 +303,68 @@ void GraphNumbered<Distance>::updateMatrix(
 				}
 
 				D.emplace_back(e.first[k ^ 1], e.second);
+				n_clamped += !Distance::in_range(e.second);
 			}
 		}
 	}
+
+	this->numClampedDistances += n_clamped;
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+size_t GraphNumbered<Distance>::updateComponents(
+	const IEdgesCollection& edges,
+	int part,
+	int n_parts) {
+
+	const NumberedEdgesCollection& numberedEdges{ dynamic_cast<const NumberedEdgesCollection&>(edges) };
+	
+	size_t n_edges = numberedEdges.data.size();
+	size_t first = n_edges * part / n_parts;
+	size_t last = n_edges * (part + 1) / n_parts;
+	size_t n_processed = 0;
+
+	for (size_t i = first; i < last; ++i) {
+		const auto& e = numberedEdges.data[i];
+		if (e.second < std::numeric_limits<double>::max()) {
+			this->matrix.components->unite(e.first[0], e.first[1]);
+			++n_processed;
+		}
+	}
+
+	return n_processed;
 }
 
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphNumbered<Distance>::saveMappings(GraphFileWriter& writer) const {
+	writer.write(local2global.data(), local2global.size());
+}
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphNumbered<Distance>::loadMappings(const char* data, size_t size) {
+
+	size_t n_ids = this->matrix.num_objects();
+	if (size < n_ids * sizeof(int)) {
+		throw std::runtime_error("Truncated object mappings");
+	}
+
+	local2global.resize(n_ids);
+	memcpy(local2global.data(), data, n_ids * sizeof(int));
+
+	if (std::any_of(local2global.begin(), local2global.end(), [](int gid) { return gid < 0; })) {
+		throw std::runtime_error("Corrupted graph file");
+	}
+
+	int max_gid = local2global.empty() ? -1 : *std::max_element(local2global.begin(), local2global.end());
+	global2local.assign(max_gid + 1, -1);
+	for (int lid = 0; lid < (int)n_ids; ++lid) {
+		global2local[local2global[lid]] = lid;
+	}
+}
 
 /*********************************************************************************************************************/
 template <class Distance>
@@ -14,6 +14,10 @@
 #include "parallel-queues.h"
 #include "io.h"
 #include "semaphore.h"
+#include "mapped_file.h"
+#include "random_access_file.h"
+#include "input_stream.h"
+#include "graph_file.h"
 
 
 #include <thread>
@@ -22,6 +26,9 @@
 #include <algorithm>
 #include <barrier>
 #include <thread>
+#include <mutex>
+#include <exception>
+#include <limits>
 
 // *******************************************************************************************/
 template <class Distance>
@@ -41,14 +48,75 @@ public:
 	size_t getNumEdges() const override { return matrix.num_elements(); }
 
 	size_t load(
-		std::ifstream& ifs,
+		const std::string& fileName,
+		InputMode inputMode,
 		const std::pair<std::string, std::string>& idColumns,
 		const std::string& distanceColumn,
 		distance_transformation_t transform,
 		const std::map<std::string, ColumnFilter>& columns2filters) override;
 
+	void setHalfMatrix(bool half) override { matrix.half_matrix = half; }
+
+	void setStreaming(bool streaming) override { 
+		matrix.components.reset(streaming ? new ConcurrentUnionFind() : nullptr); 
+	}
+
+	void setHistogram(double binWidth, int numBins, const std::string& fileName) override {
+		histogramWidth = binWidth;
+		histogramBins = numBins;
+		histogramFile = fileName;
+	}
+
+	void saveBinary(const std::string& fileName) const override;
+
+	size_t loadBinary(const std::string& fileName) override;
+
+	void saveDendrogram(const std::string& fileName, const std::vector<node_t>& dendrogram) const override;
+
+	void loadDendrogram(const std::string& fileName, std::vector<node_t>& dendrogram) override;
+
+	void saveNewick(
+		const std::string& fileName,
+		const std::vector<std::string_view>& externalNames,
+		const std::vector<node_t>& dendrogram) const override;
+
 protected:
 
+	GraphFile graphFile;
+
+	DendrogramFile dendrogramFile;
+
+	size_t numInputEdges{ 0 };
+
+	// Number of distances clamped to the range of the Distance type (fixed-point storage only).
+	std::atomic<size_t> numClampedDistances{ 0 };
+
+	double histogramWidth{ 0.001 };
+	int histogramBins{ 50 };
+	std::string histogramFile;
+
+	// Returns the beginning of the first line starting at or after p (p - 1 has to be a valid position).
+	static char* findLineStart(char* p, char* end) {
+		p = std::find_if(p - 1, end, isNewline);
+		return std::find_if(p, end, [](char c) { return !isNewline(c); });
+	}
+
+	// Minimum length of a row to be sorted by all threads together.
+	static constexpr size_t MIN_HUB_SIZE = 1 << 16;
+
+	// Runs a function on ranges of rows taken dynamically by threads (lengths of rows may differ a lot).
+	template <class Function>
+	void forEachRowRange(int n_rows, const Function& function) const;
+
+	// Sorts a vector by merging parts sorted in parallel.
+	void sortParallel(std::vector<Distance>& v) const;
+
+	// Prints histogram of distances in the verbose mode and stores it in a TSV file if requested.
+	void reportHistogram() const;
+
+	// Warns about distances which did not fit the range of the Distance type.
+	void reportClamped() const;
+
 	virtual IEdgesCollection* createEdgesCollection(size_t preallocSize) = 0;
 
 	virtual void initLoad();
@@ -72,6 +140,22 @@ protected:
 		int startRow,
 		int stride) = 0;
 
+	// Unites ends of edges from the part of the collection in the streaming mode. 
+	// Returns the number of processed edges.
+	virtual size_t updateComponents(
+		const IEdgesCollection& edges,
+		int part,
+		int n_parts) = 0;
+
+	virtual bool isNamed() const = 0;
+
+	virtual void saveMappings(GraphFileWriter& writer) const = 0;
+
+	virtual void loadMappings(const char* data, size_t size) = 0;
+
+	// Returns name of a vertex (external names are indexed by global ids of numbered graphs).
+	virtual std::string getVertexName(int localId, const std::vector<std::string_view>& externalNames) const = 0;
+
 };
 
 
@@ -84,6 +168,71 @@ void GraphSparse<Distance>::initLoad() {
 }
 
 
+/*********************************************************************************************************************/
+template <class Distance>
+template <class Function>
+void GraphSparse<Distance>::forEachRowRange(int n_rows, const Function& function) const {
+
+	const int CHUNK_SIZE = 256;
+	std::atomic<int> next_row{ 0 };
+	std::vector<std::thread> workers(numThreads);
+
+	for (int tid = 0; tid < numThreads; ++tid) {
+		workers[tid] = std::thread([&function, &next_row, n_rows, CHUNK_SIZE]() {
+			int first;
+			while ((first = next_row.fetch_add(CHUNK_SIZE)) < n_rows) {
+				function(first, std::min(first + CHUNK_SIZE, n_rows));
+			}
+			});
+	}
+
+	for (auto& w : workers) {
+		w.join();
+	}
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::sortParallel(std::vector<Distance>& v) const {
+
+	// part boundaries
+	std::vector<size_t> bounds(numThreads + 1);
+	for (int i = 0; i <= numThreads; ++i) {
+		bounds[i] = v.size() * i / numThreads;
+	}
+
+	std::vector<std::thread> workers;
+	for (int tid = 0; tid < numThreads; ++tid) {
+		workers.emplace_back([&v, &bounds, tid]() {
+			std::sort(v.begin() + bounds[tid], v.begin() + bounds[tid + 1]);
+			});
+	}
+
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	// merge neighbouring parts in rounds, pairs of every round in parallel
+	for (int step = 1; step < numThreads; step *= 2) {
+		workers.clear();
+		for (int left = 0; left + step < numThreads; left += 2 * step) {
+			size_t first = bounds[left];
+			size_t middle = bounds[left + step];
+			size_t last = bounds[std::min(left + 2 * step, numThreads)];
+
+			workers.emplace_back([&v, first, middle, last]() {
+				std::inplace_merge(v.begin() + first, v.begin() + middle, v.begin() + last);
+				});
+		}
+
+		for (auto& w : workers) {
+			w.join();
+		}
+	}
+}
+
+
 /*********************************************************************************************************************/
 template <class Distance>
 void GraphSparse<Distance>::finalizeLoad() {
@@ -91,24 +240,81 @@ void GraphSparse<Distance>::finalizeLoad() {
 	// if neccessary, sort distances in rows according to the second id
 	matrix.n_elements = 0;
 
-	std::vector<std::thread> workers(this->numThreads);
-	std::atomic<size_t> total_elements = 0;
+	int n_rows = (int)matrix.distances.size();
 
-	for (int tid = 0; tid < numThreads; ++tid) {
-		workers[tid] = std::thread([this, tid, &total_elements]() {
-			size_t local_elements = 0;
-			int n_rows = (int)this->matrix.distances.size();
+	// rows much longer than a share of a thread (hubs) are sorted afterwards by all threads together
+	size_t total_size = 0;
+	for (const auto& row : matrix.distances) {
+		total_size += row.size();
+	}
 
-			for (int i = tid; i < n_rows; i += this->numThreads) {
-				auto& row = this->matrix.distances[i];
-				std::sort(row.begin(), row.end());
-				auto newEnd = std::unique(row.begin(), row.end(), [](const Distance& a, const Distance& b) { return a.get_id() == b.get_id(); });
+	const size_t hub_size = std::max(MIN_HUB_SIZE, total_size / (4 * numThreads));
+	std::vector<int> hubs;
+	if (numThreads > 1) {
+		for (int i = 0; i < n_rows; ++i) {
+			if (matrix.distances[i].size() >= hub_size) {
+				hubs.push_back(i);
+			}
+		}
+	}
+
+	std::atomic<size_t> total_elements = 0;
 
-				row.erase(newEnd, row.end());
-				local_elements += row.size();
+	forEachRowRange(n_rows, [this, hub_size, &total_elements](int first, int last) {
+		size_t local_elements = 0;
+		
+		for (int i = first; i < last; ++i) {
+			auto& row = this->matrix.distances[i];
+			if (this->numThreads > 1 && row.size() >= hub_size) {
+				continue;
 			}
 
-			total_elements += local_elements;
+			std::sort(row.begin(), row.end());
+			auto newEnd = std::unique(row.begin(), row.end(), [](const Distance& a, const Distance& b) { return a.get_id() == b.get_id(); });
+
+			row.erase(newEnd, row.end());
+			local_elements += row.size();
+		}
+
+		total_elements += local_elements;
+		});
+
+	for (int i : hubs) {
+		auto& row = matrix.distances[i];
+		sortParallel(row);
+		auto newEnd = std::unique(row.begin(), row.end(), [](const Distance& a, const Distance& b) { return a.get_id() == b.get_id(); });
+
+		row.erase(newEnd, row.end());
+		total_elements += row.size();
+	}
+
+	// in the half matrix every edge is stored once
+	matrix.n_elements = matrix.half_matrix ? 2 * total_elements.load() : total_elements.load();
+
+	// compact rows into CSR form
+	matrix.offsets.resize(n_rows + 1);
+	matrix.offsets[0] = 0;
+	for (int i = 0; i < n_rows; ++i) {
+		matrix.offsets[i + 1] = matrix.offsets[i] + matrix.distances[i].size();
+	}
+
+	// segments are allocated one by one and rows are released right after copying, 
+	// so the memory peak exceeds the size of rows only by segments in progress
+	matrix.init_segments();
+	std::atomic<int> next_segment = 0;
+	std::vector<std::thread> workers(numThreads);
+
+	for (auto& w : workers) {
+		w = std::thread([this, &next_segment]() {
+			int s;
+			while ((s = next_segment++) < this->matrix.num_segments()) {
+				Distance* dst = this->matrix.allocate_segment(s).data();
+				for (int i = this->matrix.segment_first_row(s); i < this->matrix.segment_last_row(s); ++i) {
+					auto& row = this->matrix.distances[i];
+					dst = std::copy(row.begin(), row.end(), dst);
+					std::vector<Distance>().swap(row);
+				}
+			}
 			});
 	}
 
@@ -116,37 +322,114 @@ void GraphSparse<Distance>::finalizeLoad() {
 		w.join();
 	}
 
-	matrix.n_elements = total_elements;
+	std::vector<std::vector<Distance>>().swap(matrix.distances);
 
-	// Print distance histogram in the verbose mode
-	if (Log::getInstance(Log::LEVEL_VERBOSE).isEnabled()) {
+	if (Log::getInstance(Log::LEVEL_VERBOSE).isEnabled() || !histogramFile.empty()) {
+		reportHistogram();
+	}
+}
 
-		std::vector<double> histo_bounds{ 0 };
-		double width = 0.001;
 
-		while (histo_bounds.back() < 0.05)
-		{
-			histo_bounds.push_back(histo_bounds.back() + width);
-		}
-		histo_bounds.push_back(std::numeric_limits<double>::max());
-		std::vector<int> histo(histo_bounds.size());
-
-		for (auto& row : matrix.distances) {
-			for (const auto& e : row) {
-				for (size_t i = 0; i < histo_bounds.size(); ++i) {
-					if (e.get_d() < histo_bounds[i]) {
-						++histo[i];
-						break;
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::reportClamped() const {
+	// full matrix stores every edge twice
+	size_t n_clamped = matrix.half_matrix ? numClampedDistances.load() : numClampedDistances.load() / 2;
+	if (n_clamped > 0) {
+		LOG_NORMAL << "Warning: " << n_clamped << " distances outside [0, 1] were clamped by the selected distance precision" << std::endl;
+	}
+}
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::reportHistogram() const {
+
+	// bin 0 - negative distances, bins 1..n - [(i-1) * width, i * width), bin n + 1 - the rest
+	const int n_bins = histogramBins + 2;
+	const double width = histogramWidth;
+	const double inv_width = 1.0 / width;
+	const size_t n_elements = matrix.num_stored();
+
+	std::vector<std::vector<size_t>> local_histos(numThreads, std::vector<size_t>(n_bins));
+	std::vector<std::thread> workers(numThreads);
+
+	for (int tid = 0; tid < numThreads; ++tid) {
+		workers[tid] = std::thread([this, tid, n_bins, width, inv_width, n_elements, &local_histos]() {
+			auto& histo = local_histos[tid];
+			size_t lo = n_elements * tid / this->numThreads;
+			size_t hi = n_elements * (tid + 1) / this->numThreads;
+			
+			this->matrix.for_each_element_range(lo, hi, [&](const Distance* first, const Distance* last) {
+				for (const Distance* e = first; e < last; ++e) {
+					double d = e->get_d();
+					int bin;
+					if (d < 0) {
+						bin = 0;
+					}
+					else {
+						// direct indexing corrected to be exact w.r.t. bin bounds
+						double pos = d * inv_width + 1;
+						bin = pos < n_bins - 1 ? (int)pos : n_bins - 1;
+						if (bin > 1 && d < (bin - 1) * width) {
+							--bin;
+						}
+						else if (bin < n_bins - 1 && d >= bin * width) {
+							++bin;
+						}
 					}
+					++histo[bin];
 				}
-			}
+				});
+			});
+	}
+
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	std::vector<size_t> histo(n_bins);
+	for (const auto& local : local_histos) {
+		for (int i = 0; i < n_bins; ++i) {
+			histo[i] += local[i];
 		}
+	}
+
+	// upper bound of a bin (exclusive)
+	auto bound = [this, n_bins](int i) { 
+		return i < n_bins - 1 ? i * histogramWidth : std::numeric_limits<double>::max(); 
+	};
+
+	LOG_VERBOSE << std::endl << "Distance histogram" << std::endl;
+	for (int i = 0; i < n_bins; ++i) {
+		LOG_VERBOSE << "  d < " << bound(i) << ": " << histo[i] << std::endl;
+	}
+	LOG_VERBOSE << std::endl;
+
+	if (!histogramFile.empty()) {
+		std::ofstream ofs(histogramFile);
+		if (!ofs) {
+			throw std::runtime_error("Unable to create file " + histogramFile);
+		}
+
+		ofs << "min\tmax\tcount" << std::endl;
+		for (int i = 0; i < n_bins; ++i) {
+			if (i == 0) {
+				ofs << "-inf";
+			}
+			else {
+				ofs << bound(i - 1);
+			}
+
+			ofs << '\t';
+			if (i == n_bins - 1) {
+				ofs << "inf";
+			}
+			else {
+				ofs << bound(i);
+			}
 
-		LOG_VERBOSE << std::endl << "Distance histogram" << std::endl;
-		for (size_t i = 0; i < histo_bounds.size(); ++i) {
-			LOG_VERBOSE << "  d < " << histo_bounds[i] << ": " << histo[i] << std::endl;
+			ofs << '\t' << histo[i] << '\n';
 		}
-		LOG_VERBOSE << std::endl;
 	}
 }
 
@@ -154,7 +437,8 @@ void GraphSparse<Distance>::finalizeLoad() {
 /*********************************************************************************************************************/
 template <class Distance>
 size_t GraphSparse<Distance>::load(
-	std::ifstream& ifs,
+	const std::string& fileName,
+	InputMode inputMode,
 	const std::pair<std::string, std::string>& idColumns,
 	const std::string& distanceColumn,
 	distance_transformation_t transform,
@@ -165,12 +449,79 @@ size_t GraphSparse<Distance>::load(
 	int numParsers = std::max(1, (numThreads - 2) / 2); // at least one parser
 	int numUpdaters = std::max(1, (numThreads - 2) / 2); // at least one updater
 
+	// compressed files can be read sequentially only
+	if (inputMode != InputMode::Stream && InputStream::detectCompression(fileName) != Compression::None) {
+		LOG_NORMAL << "Warning: compressed input, using stream mode" << std::endl;
+		inputMode = InputMode::Stream;
+	}
+
+	std::unique_ptr<InputStream> input;
+	std::string header;
+	size_t headerSize = 0;
+
+	if (inputMode == InputMode::Stream) {
+		input = InputStream::open(fileName, numParsers);
+		input->getline(header);
+	}
+	else {
+		std::ifstream ifs(fileName, std::ios_base::binary);
+		if (!ifs) {
+			throw std::runtime_error("Unable to open distance file");
+		}
+		std::getline(ifs, header);
+		headerSize = ifs ? (size_t)ifs.tellg() : header.size();
+	}
+
+	// get header
+	this->processHeader(header, idColumns, distanceColumn, columns2filters);
+
+	// in the mapped and parallel modes parsers take blocks by themselves
+	MappedFile mappedFile;
+	RandomAccessFile raFile;
+	std::vector<char*> blockBounds;
+	size_t dataOffset = 0;
+	size_t fileSize = 0;
+	size_t blockSize = 128ULL << 20;
+	int numBlocks = 0;
+
+	if (inputMode != InputMode::Stream) {
+		dataOffset = headerSize;
+
+		bool opened = (inputMode == InputMode::Mapped) ? mappedFile.open(fileName) : raFile.open(fileName);
+		if (!opened) {
+			throw std::runtime_error("Unable to open distance file");
+		}
+
+		// split data into blocks (at least few per parser)
+		fileSize = (inputMode == InputMode::Mapped) ? mappedFile.size() : raFile.size();
+		dataOffset = std::min(dataOffset, fileSize);
+		blockSize = std::clamp<size_t>((fileSize - dataOffset) / (4 * numParsers), 1ULL << 20, 128ULL << 20);
+		numBlocks = (int)((fileSize - dataOffset + blockSize - 1) / blockSize);
+	}
+
+	if (inputMode == InputMode::Mapped) {
+		// block bounds have to be established before parsing as parsers modify the contents
+		char* data_end = mappedFile.data() + fileSize;
+		blockBounds.resize(numBlocks + 1);
+		blockBounds[0] = mappedFile.data() + dataOffset;
+		
+		for (int i = 1; i < numBlocks; ++i) {
+			blockBounds[i] = std::max(blockBounds[i - 1], findLineStart(blockBounds[0] + i * blockSize, data_end));
+		}
+		blockBounds[numBlocks] = data_end;
+	}
+
 	// create a vector of input buffers and edges collections
-	std::vector<InputBuffer*> buffers(numParsers + 2);
+	// (in the parallel mode buffer contains also a margin for resynchronization at line starts)
+	const size_t margin = 1ULL << 20;
+	std::vector<InputBuffer*> buffers(inputMode == InputMode::Mapped ? 0 : numParsers + 2);
 	std::vector<IEdgesCollection*> edgesCollections(numParsers + 2);
 
 	for (int i = 0; i < (int)buffers.size(); ++i) {
-		buffers[i] = new InputBuffer(128ULL << 20);
+		buffers[i] = new InputBuffer(inputMode == InputMode::Stream ? blockSize : blockSize + 1 + margin);
+	}
+	
+	for (int i = 0; i < (int)edgesCollections.size(); ++i) {
 		edgesCollections[i] = this->createEdgesCollection(1ULL << 20);
 	}
 
@@ -182,48 +533,143 @@ size_t GraphSparse<Distance>::load(
 	};
 
 	// create queues
-	refresh::parallel_queue<int> freeBuffersQueue(buffers.size(), numParsers, "free-buffers-queue");
-	refresh::parallel_queue<task_t> blocksQueue(buffers.size(), 1, "blocks-queue");
+	refresh::pipeline_queue<int> freeBuffersQueue(std::max<size_t>(buffers.size(), 1), numParsers, "free-buffers-queue");
+	refresh::pipeline_queue<task_t> blocksQueue(std::max<size_t>(buffers.size(), 1), 1, "blocks-queue");
 
-	refresh::parallel_queue<int> freeCollectionsQueue(edgesCollections.size(), numUpdaters, "free-collections-queue");
-	refresh::parallel_priority_queue<task_t> edgesQueue(edgesCollections.size(), numParsers, "edges-queue");
+	refresh::pipeline_queue<int> freeCollectionsQueue(edgesCollections.size(), numUpdaters, "free-collections-queue");
+	refresh::pipeline_priority_queue<task_t> edgesQueue(edgesCollections.size(), numParsers, "edges-queue");
 
-	std::vector<refresh::parallel_queue<task_t>*> updatersQueues;
+	std::vector<refresh::pipeline_queue<task_t>*> updatersQueues;
 	for (int i = 0; i < numUpdaters; ++i) {
-		updatersQueues.push_back(new refresh::parallel_queue<task_t>(1, 1, "updater-queue-" + std::to_string(i)));
+		updatersQueues.push_back(new refresh::pipeline_queue<task_t>(1, 1, "updater-queue-" + std::to_string(i)));
 	}
 
-	// get header
-	this->processHeader(ifs, idColumns, distanceColumn, columns2filters);
-
 	this->initLoad();
 
 	// add free buffers and edges collecion to queue
 	for (int i = 0; i < (int)buffers.size(); ++i) {
 		freeBuffersQueue.push(int{ i });
+	}
+
+	for (int i = 0; i < (int)edgesCollections.size(); ++i) {
 		freeCollectionsQueue.push(int{ i });
 	}
 
+	// input block is released either by putting buffer back to the queue or by giving mapped pages back to OS
+	auto releaseBlock = [inputMode, &freeBuffersQueue, &mappedFile, &blockBounds](const task_t& task) {
+		if (inputMode == InputMode::Mapped) {
+			mappedFile.release(blockBounds[task.portion_id], blockBounds[task.portion_id + 1]);
+		}
+		else {
+			freeBuffersQueue.push(int{ task.buffer_id });
+		}
+	};
+
+	// in the parallel mode the block is read starting from a byte preceding it (to check whether 
+	// the block starts at a line beginning) and ends at a line start after the block 
+	auto readBlock = [&raFile, dataOffset, fileSize, blockSize, margin](InputBuffer& buf, int block_id) {
+		size_t lo = dataOffset + block_id * blockSize;
+		size_t hi = std::min(lo + blockSize, fileSize);
+		size_t from = (block_id == 0) ? lo : lo - 1;
+
+		size_t n_read = raFile.read(buf.data, from, std::min(buf.size, fileSize - from));
+		char* data_end = buf.data + n_read;
+
+		buf.block_begin = (block_id == 0) ? buf.data : findLineStart(buf.data + 1, data_end);
+		buf.block_end = (hi == fileSize) ? data_end : findLineStart(buf.data + (hi - from), data_end);
+
+		if (buf.block_end == data_end && from + n_read < fileSize) {
+			throw std::runtime_error("Error loading distances: line longer than " + std::to_string(margin) + " bytes");
+		}
+
+		buf.block_begin = std::min(buf.block_begin, buf.block_end);
+	};
+
+	// next block to be taken by the parser in the mapped and parallel modes
+	std::atomic<int> nextBlock = 0;
+
+	// first error reported by the loader or parsers (rethrown after joining the threads); 
+	// after a failure blocks already taken are passed through the pipeline empty, so that
+	// no thread waits for a missing block, and no new blocks are taken
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	std::atomic<bool> failed = false;
+
+	auto setError = [&errorMutex, &error, &failed](std::exception_ptr e) {
+		std::lock_guard<std::mutex> lck(errorMutex);
+		if (!error) {
+			error = e;
+		}
+		failed = true;
+	};
+	
 	// start parsers
 	std::vector<std::thread> parsers(numParsers);
 	for (int tid = 0; tid < (int)parsers.size(); ++tid) {
-		parsers[tid] = std::thread([tid, this,
-			&buffers, &freeBuffersQueue, &blocksQueue, &freeCollectionsQueue, &edgesCollections, &edgesQueue,
-			transform, &n_total_distances] () {
+		parsers[tid] = std::thread([tid, this, inputMode, numBlocks,
+			&buffers, &blockBounds, &nextBlock, &freeBuffersQueue, &blocksQueue, &freeCollectionsQueue, &edgesCollections, &edgesQueue,
+			&readBlock, &releaseBlock, &setError, &failed, transform, &n_total_distances] () {
 
 				int collection_id;
 				task_t task;
 
-				while (freeCollectionsQueue.pop(collection_id) && blocksQueue.pop(task)) {
+				// block is taken after a collection, so every block in progress has its collection 
+				auto getBlock = [&]() -> bool {
+					if (inputMode == InputMode::Stream) {
+						return blocksQueue.pop(task);
+					}
+					
+					// failure is checked before taking a block, so taken blocks form a prefix
+					task = task_t{ -1, false, -1, failed ? numBlocks : nextBlock++ };
+					if (task.portion_id >= numBlocks) {
+						freeCollectionsQueue.push(int{ collection_id });
+						return false;
+					}
+					
+					if (inputMode == InputMode::Parallel) {
+						freeBuffersQueue.pop(task.buffer_id);
+						InputBuffer& buf = *buffers[task.buffer_id];
+						try {
+							readBlock(buf, task.portion_id);
+						}
+						catch (...) {
+							setError(std::current_exception());
+							buf.block_begin = buf.block_end = buf.data;
+						}
+					}
+					return true;
+				};
+
+				while (freeCollectionsQueue.pop(collection_id) && getBlock()) {
 					LOG_DEBUG << "parser-" << tid << " pop " << task.portion_id << " (buf " << task.buffer_id << ")" << std::endl;
 
-					InputBuffer* buf = buffers[task.buffer_id];
+					char* block_begin;
+					char* block_end;
+					
+					if (inputMode != InputMode::Mapped) {
+						block_begin = buffers[task.buffer_id]->block_begin;
+						block_end = buffers[task.buffer_id]->block_end;
+					}
+					else {
+						block_begin = blockBounds[task.portion_id];
+						block_end = blockBounds[task.portion_id + 1];
+					}
+
 					IEdgesCollection* edges = edgesCollections[collection_id];
 
 					edges->clear();
 					size_t n_local_rows = 0;
 
-					bool can_release = this->parseBlock(buf->block_begin, buf->block_end, transform, *edges, n_local_rows);
+					bool can_release = true;
+					try {
+						if (!failed) {
+							can_release = this->parseBlock(block_begin, block_end, transform, *edges, n_local_rows);
+						}
+					}
+					catch (...) {
+						setError(std::current_exception());
+						edges->clear();
+					}
 					n_total_distances += n_local_rows;
 
 					// fill some info
@@ -235,7 +681,7 @@ size_t GraphSparse<Distance>::load(
 
 					if (can_release) {
 						LOG_DEBUG << "parser-" << tid << " free(buf " << task.buffer_id << ")" << std::endl;
-						freeBuffersQueue.push(int{ task.buffer_id });
+						releaseBlock(task);
 					}
 				}
 
@@ -246,7 +692,8 @@ size_t GraphSparse<Distance>::load(
 
 	// start mapper
 	Semaphore activeUpdaters;
-	std::thread mapper([this, &edgesCollections, &freeCollectionsQueue, &edgesQueue, &freeBuffersQueue, &updatersQueues, &activeUpdaters]() {
+	std::atomic<size_t> n_streamed_edges = 0;
+	std::thread mapper([this, &edgesCollections, &freeCollectionsQueue, &edgesQueue, &releaseBlock, &updatersQueues, &activeUpdaters]() {
 
 		task_t task;
 
@@ -258,6 +705,9 @@ size_t GraphSparse<Distance>::load(
 			// wait with extension until updaters finish previous portion
 			activeUpdaters.waitForZero();
 			this->extendMatrix();
+			if (this->matrix.components) {
+				this->matrix.components->resize((int)this->matrix.distances.size());
+			}
 
 			// push task to all updaters
 			LOG_DEBUG << "mapper push " << task.portion_id << " [col " << task.collection_id << "]" << std::endl;
@@ -268,7 +718,7 @@ size_t GraphSparse<Distance>::load(
 
 			if (!task.buffer_released) {
 				LOG_DEBUG << "mapper free (buf " << task.buffer_id << ")" << std::endl;
-				freeBuffersQueue.push(int{ task.buffer_id });
+				releaseBlock(task);
 			}
 
 		}
@@ -283,7 +733,7 @@ size_t GraphSparse<Distance>::load(
 	std::barrier syncPoint(updaters.size());
 
 	for (int tid = 0; tid < updaters.size(); ++tid) {
-		updaters[tid] = std::thread([this, tid, &edgesCollections, &freeCollectionsQueue, &updatersQueues, &syncPoint, &activeUpdaters]() {
+		updaters[tid] = std::thread([this, tid, &edgesCollections, &freeCollectionsQueue, &updatersQueues, &syncPoint, &activeUpdaters, &n_streamed_edges]() {
 
 			task_t task;
 
@@ -291,7 +741,12 @@ size_t GraphSparse<Distance>::load(
 
 				LOG_DEBUG << "updater-" << tid << " pop " << task.portion_id << "[col " << task.collection_id << "]" << std::endl;
 				IEdgesCollection* edges = edgesCollections[task.collection_id];
-				this->updateMatrix(*edges, tid, (int)updatersQueues.size());
+				if (this->matrix.components) {
+					n_streamed_edges += this->updateComponents(*edges, tid, (int)updatersQueues.size());
+				}
+				else {
+					this->updateMatrix(*edges, tid, (int)updatersQueues.size());
+				}
 
 				// decrement and wait until all updaters finish
 				activeUpdaters.dec();
@@ -307,59 +762,67 @@ size_t GraphSparse<Distance>::load(
 	}
 
 
-	// start loader
-	int buffer_id = -1;
-	freeBuffersQueue.pop(buffer_id);
-	LOG_DEBUG << "loader reserve (buf" << buffer_id << ")" << std::endl;
+	// start loader (stream mode only)
+	if (inputMode == InputMode::Stream) {
+		int buffer_id = -1;
+		freeBuffersQueue.pop(buffer_id);
+		LOG_DEBUG << "loader reserve (buf" << buffer_id << ")" << std::endl;
 
-	bool continueReading = true;
-	for (int i_block = 0; continueReading; ++i_block) {
+		try {
+			bool continueReading = true;
+			for (int i_block = 0; continueReading && !failed; ++i_block) {
 
-		InputBuffer& buf{ *buffers[buffer_id] };
+				InputBuffer& buf{ *buffers[buffer_id] };
 
-		size_t n_wanted = buf.data + buf.size - buf.block_begin;
-		ifs.read(buf.block_begin, n_wanted);
-		size_t n_read = (ifs) ? n_wanted : ifs.gcount();
+				size_t n_wanted = buf.data + buf.size - buf.block_begin;
+				size_t n_read = input->read(buf.block_begin, n_wanted);
 
-		// reset block
-		buf.block_end = buf.block_begin + n_read;
-		buf.block_begin = buf.data;
+				// reset block
+				buf.block_end = buf.block_begin + n_read;
+				buf.block_begin = buf.data;
 
-		int n_tail = 0;
+				int n_tail = 0;
 
-		// no more data
-		if (n_read < n_wanted) {
-			continueReading = false;
-		}
-		else {
-			// find last newline
-			while (!isNewline(*(buf.block_end - 1))) {
-				--buf.block_end;
-				++n_tail;
-			}
-		}
+				// no more data
+				if (n_read < n_wanted) {
+					continueReading = false;
+				}
+				else {
+					// find last newline
+					while (!isNewline(*(buf.block_end - 1))) {
+						--buf.block_end;
+						++n_tail;
+					}
+				}
+
+				// pop next free buffer
+				int next_buffer_id = -1;
+				freeBuffersQueue.pop(next_buffer_id);
+				InputBuffer& nextBuf{ *buffers[next_buffer_id] };
 
-		// pop next free buffer
-		int next_buffer_id = -1;
-		freeBuffersQueue.pop(next_buffer_id);
-		InputBuffer& nextBuf{ *buffers[next_buffer_id] };
+				LOG_DEBUG << "loader reserve (buf " << next_buffer_id << ")" << std::endl;
 
-		LOG_DEBUG << "loader reserve (buf " << next_buffer_id << ")" << std::endl;
+				// copy remaining part after consuming all the lines
+				if (continueReading && n_tail > 0) {
+					memcpy(nextBuf.data, buf.block_end, n_tail);
+					nextBuf.block_begin = nextBuf.data + n_tail;
+					nextBuf.block_end = nullptr;
+				}
+				else {
+					nextBuf.block_begin = nextBuf.data;
+					nextBuf.block_end = nullptr;
+				}
 
-		// copy remaining part after consuming all the lines
-		if (continueReading && n_tail > 0) {
-			memcpy(nextBuf.data, buf.block_end, n_tail);
-			nextBuf.block_begin = nextBuf.data + n_tail;
-			nextBuf.block_end = nullptr;
+				LOG_DEBUG << "loader push " << i_block << " (buf " << buffer_id << ")" << std::endl;
+				blocksQueue.push(task_t{ buffer_id, false, -1, i_block });
+				buffer_id = next_buffer_id;
+			}
 		}
-		else {
-			nextBuf.block_begin = nextBuf.data;
-			nextBuf.block_end = nullptr;
+		catch (...) {
+			setError(std::current_exception());
 		}
 
-		LOG_DEBUG << "loader push " << i_block << " (buf " << buffer_id << ")" << std::endl;
-		blocksQueue.push(task_t{ buffer_id, false, -1, i_block });
-		buffer_id = next_buffer_id;
+		input.reset();
 	}
 
 	blocksQueue.mark_completed();
@@ -369,12 +832,299 @@ size_t GraphSparse<Distance>::load(
 	mapper.join();
 	for (auto& t : updaters) { t.join(); }
 
-	this->finalizeLoad();
-
 	// free memory 
 	for (auto& e : buffers) { delete e; }
 	for (auto& e : edgesCollections) { delete e; }
 	for (auto& e : updatersQueues) { delete e; }
 
-	return n_total_distances;
-}
\ No newline at end of file
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	this->finalizeLoad();
+	reportClamped();
+
+	// edges were not stored (duplicates cannot be removed)
+	if (matrix.components) {
+		matrix.n_elements = 2 * n_streamed_edges;
+	}
+
+	numInputEdges = n_total_distances;
+	return numInputEdges;
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::saveBinary(const std::string& fileName) const {
+
+	GraphFileHeader header;
+	header.flags = (isNamed() ? GraphFileHeader::FLAG_NAMED : 0) 
+		| (Distance::HAS_DISTANCE ? GraphFileHeader::FLAG_DISTANCES : 0)
+		| (matrix.half_matrix ? GraphFileHeader::FLAG_HALF : 0);
+	header.numRows = matrix.num_objects();
+	header.numElements = matrix.num_stored();
+	header.numInputEdges = numInputEdges;
+
+	GraphFileWriter writer(fileName);
+	writer.write(&header, 1);
+
+	// row offsets
+	std::vector<uint64_t> offsets(matrix.offsets.begin(), matrix.offsets.end());
+	writer.write(offsets.data(), offsets.size());
+	
+	// neighbour ids
+	std::vector<uint32_t> ids;
+	for (size_t i = 0; i < header.numRows; ++i) {
+		ids.clear();
+		std::transform(matrix.begin((int)i), matrix.end((int)i), std::back_inserter(ids), [](const Distance& e) { return e.get_id(); });
+		writer.write(ids.data(), ids.size());
+	}
+	writer.pad();
+
+	// distances
+	if (Distance::HAS_DISTANCE) {
+		std::vector<double> dists;
+		for (size_t i = 0; i < header.numRows; ++i) {
+			dists.clear();
+			std::transform(matrix.begin((int)i), matrix.end((int)i), std::back_inserter(dists), [](const Distance& e) { return e.get_d(); });
+			writer.write(dists.data(), dists.size());
+		}
+	}
+
+	saveMappings(writer);
+	writer.close();
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+size_t GraphSparse<Distance>::loadBinary(const std::string& fileName) {
+
+	graphFile.open(fileName);
+	const GraphFileHeader& header = graphFile.header;
+
+	if (header.isNamed() != isNamed()) {
+		throw std::runtime_error("Graph file type mismatch (named/numbered identifiers)");
+	}
+
+	if (Distance::HAS_DISTANCE && !header.hasDistances()) {
+		throw std::runtime_error("Graph file does not contain distances required by the algorithm "
+			"(save the graph with complete, average, weighted, uclust, or leiden algorithm)");
+	}
+
+	// half matrix is an optimization - file with a full one can be always used
+	if (header.isHalf() && !matrix.half_matrix) {
+		throw std::runtime_error("Graph file stores a half matrix which can be used only with single, leiden, and linkage algorithms with rnn engine");
+	}
+	matrix.half_matrix = header.isHalf();
+
+	numInputEdges = header.numInputEdges;
+	
+	const uint64_t* offsets = graphFile.offsets();
+	const uint32_t* ids = graphFile.ids();
+	const double* dists = header.hasDistances() ? graphFile.distances() : nullptr;
+	if (header.numRows >= (uint64_t)std::numeric_limits<int>::max()) {
+		throw std::runtime_error("Corrupted graph file");
+	}
+	int n_rows = (int)header.numRows;
+
+	// offsets have to form a valid CSR (ids are verified when filling segments)
+	if (offsets[0] != 0 || offsets[n_rows] != header.numElements || 
+		!std::is_sorted(offsets, offsets + n_rows + 1)) {
+		throw std::runtime_error("Corrupted graph file");
+	}
+
+	matrix.offsets.assign(offsets, offsets + n_rows + 1);
+	matrix.n_elements = header.isHalf() ? 2 * header.numElements : header.numElements;
+	matrix.init_segments();
+
+	std::atomic<int> next_segment = 0;
+	std::atomic<bool> corrupted = false;
+	std::vector<std::thread> workers(this->numThreads);
+	
+	for (int tid = 0; tid < numThreads; ++tid) {
+		workers[tid] = std::thread([this, &next_segment, &corrupted, ids, dists, n_rows]() {
+			int s;
+			size_t n_clamped = 0;
+			bool bad_id = false;
+			while ((s = next_segment++) < this->matrix.num_segments()) {
+				auto& segment = this->matrix.allocate_segment(s);
+				uint64_t first = this->matrix.offsets[this->matrix.segment_first_row(s)];
+				for (size_t j = 0; j < segment.size(); ++j) {
+					double d = dists ? dists[first + j] : 0.0;
+					bad_id |= ids[first + j] >= (uint32_t)n_rows;
+					n_clamped += !Distance::in_range(d);
+					segment[j] = Distance(ids[first + j], d);
+				}
+			}
+			this->numClampedDistances += n_clamped;
+			if (bad_id) {
+				corrupted = true;
+			}
+			});
+	}
+
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	if (corrupted) {
+		matrix.clear_rows();
+		throw std::runtime_error("Corrupted graph file");
+	}
+	reportClamped();
+
+	loadMappings(graphFile.mappings(), graphFile.mappingsSize());
+
+	return numInputEdges;
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::saveDendrogram(const std::string& fileName, const std::vector<node_t>& dendrogram) const {
+
+	DendrogramFileHeader header;
+	header.flags = isNamed() ? DendrogramFileHeader::FLAG_NAMED : 0;
+	header.numObjects = matrix.num_objects();
+	header.numMerges = dendrogram.empty() ? 0 : dendrogram.size() - header.numObjects;
+
+	GraphFileWriter writer(fileName);
+	writer.write(&header, 1);
+
+	// first nodes of the dendrogram are objects
+	std::vector<DendrogramFileNode> merges(header.numMerges);
+	std::transform(dendrogram.end() - header.numMerges, dendrogram.end(), merges.begin(), [](const node_t& n) {
+		return DendrogramFileNode{ n.first, n.second, n.distance };
+		});
+	writer.write(merges.data(), merges.size());
+
+	saveMappings(writer);
+	writer.close();
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::loadDendrogram(const std::string& fileName, std::vector<node_t>& dendrogram) {
+
+	dendrogramFile.open(fileName);
+	const DendrogramFileHeader& header = dendrogramFile.header;
+
+	if (header.isNamed() != isNamed()) {
+		throw std::runtime_error("Dendrogram file type mismatch (named/numbered identifiers)");
+	}
+
+	// vertices without edges
+	matrix.offsets.assign(header.numObjects + 1, 0);
+	matrix.init_segments();
+	matrix.n_elements = 0;
+
+	dendrogram.assign(header.numObjects, node_t());
+	dendrogram.reserve(header.numObjects + header.numMerges);
+
+	const DendrogramFileNode* merges = dendrogramFile.merges();
+	for (uint64_t i = 0; i < header.numMerges; ++i) {
+		const auto& m = merges[i];
+		
+		// merged nodes have to exist before (traversals rely on that)
+		int64_t n_existing = (int64_t)dendrogram.size();
+		if (m.first < 0 || m.second < 0 || m.first >= n_existing || m.second >= n_existing) {
+			throw std::runtime_error("Corrupted dendrogram file");
+		}
+		dendrogram.emplace_back(m.first, m.second, m.distance);
+	}
+
+	loadMappings(dendrogramFile.mappings(), dendrogramFile.mappingsSize());
+}
+
+
+/*********************************************************************************************************************/
+template <class Distance>
+void GraphSparse<Distance>::saveNewick(
+	const std::string& fileName,
+	const std::vector<std::string_view>& externalNames,
+	const std::vector<node_t>& dendrogram) const {
+
+	std::vector<char> filebuf(16ULL << 20);
+	std::ofstream ofs;
+	ofs.rdbuf()->pubsetbuf(filebuf.data(), filebuf.size());
+	ofs.open(fileName, std::ios_base::binary);
+	if (!ofs) {
+		throw std::runtime_error("Unable to create file " + fileName);
+	}
+	ofs.precision(10);
+
+	int n_objects = (int)matrix.num_objects();
+	int n_nodes = std::max(n_objects, (int)dendrogram.size());
+
+	std::vector<int> parents(n_nodes, -1);
+	for (int i = n_objects; i < n_nodes; ++i) {
+		parents[dendrogram[i].first] = i;
+		parents[dendrogram[i].second] = i;
+	}
+
+	// objects are leaves at height 0, groups are at the height of their merge
+	auto height = [&dendrogram, n_objects](int pos) { return pos < n_objects ? 0.0 : dendrogram[pos].distance; };
+
+	auto write_name = [&ofs](const std::string& name) {
+		if (name.find_first_of(" \t\r\n()[]':;,") == std::string::npos) {
+			ofs << name;
+		}
+		else {
+			// quoted label with apostrophes doubled
+			ofs << '\'';
+			for (char c : name) {
+				if (c == '\'') { ofs << '\''; }
+				ofs << c;
+			}
+			ofs << '\'';
+		}
+	};
+
+	// trees are written without recursion as they may be very deep
+	std::vector<std::pair<int, int>> stack; // node position, number of visited children
+
+	for (int root = n_nodes - 1; root >= 0; --root) {
+		if (parents[root] != -1) {
+			continue;
+		}
+
+		stack.emplace_back(root, 0);
+		while (!stack.empty()) {
+			auto& [pos, n_visited] = stack.back();
+
+			if (pos < n_objects) {
+				write_name(getVertexName(pos, externalNames));
+			}
+			else if (n_visited == 0) {
+				ofs << '(';
+				++n_visited;
+				stack.emplace_back(dendrogram[pos].first, 0);
+				continue;
+			}
+			else if (n_visited == 1) {
+				ofs << ',';
+				++n_visited;
+				stack.emplace_back(dendrogram[pos].second, 0);
+				continue;
+			}
+			else {
+				ofs << ')';
+			}
+
+			if (parents[pos] != -1) {
+				ofs << ':' << height(parents[pos]) - height(pos);
+			}
+			stack.pop_back();
+		}
+
+		ofs << ";\n";
+	}
+
+	ofs.close();
+	if (!ofs) {
+		throw std::runtime_error("Error writing Newick file");
+	}
+}
@@ -9,8 +9,13 @@
 // *******************************************************************************************
 
 #include <cstdint>
+#include <cstring>
 #include <string_view>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 
 // *******************************************************************************************
 class StringHasher {
@@ -168,3 +173,81 @@ public:
 		return h1 ^ h2;
 	}
 };
+
+
+// *****************************************************************************************
+// Wyhash-style hashing: 8-byte loads and 64x64->128 bit multiplications instead of byte-wise 
+// loads, which makes it several times faster than Murmur64_full on short names. 
+// Hashes depend on the endianness, so they should not be stored.
+template <class string_t>
+class WyHash64 {
+
+	static constexpr uint64_t s0 = 0xa0761d6478bd642full;
+	static constexpr uint64_t s1 = 0xe7037ed1a0b428dbull;
+	static constexpr uint64_t seed = 0x8ebc6af09c88c6e3ull;
+
+	static void mum(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+		__uint128_t r = (__uint128_t)a * b;
+		a = (uint64_t)r;
+		b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		a = _umul128(a, b, &b);
+#else
+		uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t t = rl + (rm0 << 32);
+		uint64_t c = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		c += lo < t;
+		a = lo;
+		b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+	}
+
+	static uint64_t mix(uint64_t a, uint64_t b) { mum(a, b); return a ^ b; }
+
+	static uint64_t load64(const char* p) { uint64_t x; std::memcpy(&x, p, 8); return x; }
+	
+	static uint64_t load32(const char* p) { uint32_t x; std::memcpy(&x, p, 4); return x; }
+
+public:
+	size_t operator()(const string_t& sv) const {
+
+		const char* p = sv.data();
+		size_t len = sv.size();
+		uint64_t h = seed ^ mix(seed ^ s0, s1);
+		uint64_t a, b;
+
+		if (len <= 16) {
+			if (len >= 4) {
+				size_t shift = (len >> 3) << 2; // 0 or 4
+				a = (load32(p) << 32) | load32(p + shift);
+				b = (load32(p + len - 4) << 32) | load32(p + len - 4 - shift);
+			}
+			else if (len > 0) {
+				a = ((uint64_t)(uint8_t)p[0] << 16) | ((uint64_t)(uint8_t)p[len >> 1] << 8) | (uint8_t)p[len - 1];
+				b = 0;
+			}
+			else {
+				a = b = 0;
+			}
+		}
+		else {
+			size_t i = len;
+			while (i > 16) {
+				h = mix(load64(p) ^ s1, load64(p + 8) ^ h);
+				i -= 16;
+				p += 16;
+			}
+			// last 16 bytes (may overlap with the already processed ones)
+			a = load64(p + i - 16);
+			b = load64(p + i - 8);
+		}
+
+		a ^= s1;
+		b ^= h;
+		mum(a, b);
+		return mix(a ^ s0 ^ len, b ^ s1);
+	}
+};
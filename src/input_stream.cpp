@@ -0,0 +1,557 @@
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include "input_stream.h"
+#include "parallel-queues.h"
+#include "log.h"
+
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <exception>
+
+#ifndef NO_GZIP
+#include <zlib.h>
+#endif
+
+#ifndef NO_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+using namespace std;
+
+// *******************************************************************************************/
+class FileInputStream : public InputStream {
+	std::vector<char> filebuf;
+	std::ifstream ifs;
+
+public:
+	FileInputStream(const std::string& fileName) : filebuf(128ULL << 20) { // 128MB buffer
+		ifs.rdbuf()->pubsetbuf(filebuf.data(), filebuf.size());
+		ifs.open(fileName, ios_base::binary);
+
+		if (!ifs) {
+			throw std::runtime_error("Unable to open distance file");
+		}
+	}
+
+	size_t read(char* dst, size_t size) override {
+		ifs.read(dst, size);
+		return ifs.gcount();
+	}
+};
+
+
+// *******************************************************************************************
+// Base class for compressed streams. Compressed data is read in large chunks.
+// *******************************************************************************************
+class CompressedInputStream : public InputStream {
+protected:
+	std::ifstream ifs;
+	std::vector<char> inBuffer;
+
+	size_t readCompressed() {
+		ifs.read(inBuffer.data(), inBuffer.size());
+		return ifs.gcount();
+	}
+
+public:
+	CompressedInputStream(const std::string& fileName) : inBuffer(16ULL << 20) {
+		ifs.open(fileName, ios_base::binary);
+
+		if (!ifs) {
+			throw std::runtime_error("Unable to open distance file");
+		}
+	}
+};
+
+
+// *******************************************************************************************
+// Base class for streams decompressed in parallel. The reader thread splits compressed data
+// into packs of independent units (BGZF members, zstd frames) which are decompressed by workers
+// and collected back in the original order.
+// *******************************************************************************************
+class ParallelInputStream : public CompressedInputStream {
+
+	struct pack_t {
+		std::vector<char> data;
+	};
+
+	static const size_t PACK_SIZE = 4ULL << 20;
+
+	refresh::parallel_queue<std::pair<int, pack_t>> packsQueue;
+	refresh::parallel_priority_queue<pack_t> decompressedQueue;
+
+	std::thread reader;
+	std::vector<std::thread> workers;
+
+	pack_t current;
+	size_t currentPos{ 0 };
+	bool finished{ false };
+
+	// first error reported by reader or workers (rethrown by the consumer)
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	void setError(std::exception_ptr e) {
+		std::lock_guard<std::mutex> lck(errorMutex);
+		if (!error) {
+			error = e;
+		}
+	}
+
+protected:
+	// Returns size of the unit starting at p or 0 when n bytes do not suffice to determine it.
+	virtual size_t unitSize(const char* p, size_t n) const = 0;
+
+	// Decompresses all units from the compressed pack appending them to out.
+	virtual void decompress(const char* src, size_t n, std::vector<char>& out) const = 0;
+
+	// Splits compressed data into packs of complete units.
+	void readPacks() {
+		std::vector<char> buf(inBuffer.size());
+		size_t filled = 0;
+		int pack_id = 0;
+		bool eof = false;
+
+		while (!eof) {
+			// units larger than a buffer require extension
+			if (filled == buf.size()) {
+				buf.resize(buf.size() * 2);
+			}
+
+			ifs.read(buf.data() + filled, buf.size() - filled);
+			size_t n_read = ifs.gcount();
+			eof = (filled + n_read < buf.size());
+			filled += n_read;
+
+			// split complete units into packs
+			size_t pos = 0;
+			size_t pack_start = 0;
+			while (pos < filled) {
+				size_t us = unitSize(buf.data() + pos, filled - pos);
+				if (us == 0 || us > filled - pos) {
+					break;
+				}
+
+				pos += us;
+				if (pos - pack_start >= PACK_SIZE || (eof && pos == filled)) {
+					packsQueue.push(std::make_pair(pack_id++, pack_t{ std::vector<char>(buf.data() + pack_start, buf.data() + pos) }));
+					pack_start = pos;
+				}
+			}
+
+			if (eof && pack_start < filled) {
+				throw std::runtime_error("Error decompressing input: truncated file");
+			}
+
+			// move incomplete part to the beginning
+			std::copy(buf.data() + pack_start, buf.data() + filled, buf.data());
+			filled -= pack_start;
+		}
+	}
+
+	// Threads have to be started after construction as they call virtual methods.
+	void start(int numThreads) {
+		int numWorkers = std::max(1, numThreads);
+
+		reader = std::thread([this]() {
+			try {
+				readPacks();
+			}
+			catch (...) {
+				setError(std::current_exception());
+			}
+
+			packsQueue.mark_completed();
+		});
+
+		for (int i = 0; i < numWorkers; ++i) {
+			workers.emplace_back([this]() {
+				std::pair<int, pack_t> compressed;
+				while (packsQueue.pop(compressed)) {
+					pack_t decompressed;
+					try {
+						decompress(compressed.second.data.data(), compressed.second.data.size(), decompressed.data);
+					}
+					catch (...) {
+						setError(std::current_exception());
+					}
+					decompressedQueue.push(compressed.first, std::move(decompressed));
+				}
+				decompressedQueue.mark_completed();
+			});
+		}
+	}
+
+	void stop() {
+		// consume remaining packs so that threads can finish
+		while (!finished && decompressedQueue.pop(current)) {}
+		finished = true;
+
+		if (reader.joinable()) {
+			reader.join();
+		}
+		for (auto& w : workers) {
+			w.join();
+		}
+		workers.clear();
+	}
+
+public:
+	ParallelInputStream(const std::string& fileName, int numThreads) :
+		CompressedInputStream(fileName),
+		packsQueue(2 * std::max(1, numThreads), 1, "packs-queue"),
+		decompressedQueue(2 * std::max(1, numThreads), std::max(1, numThreads), "decompressed-queue") {}
+
+	size_t read(char* dst, size_t size) override {
+		size_t n_total = 0;
+
+		while (n_total < size) {
+			if (currentPos == current.data.size()) {
+				bool popped = !finished && decompressedQueue.pop(current);
+
+				std::unique_lock<std::mutex> lck(errorMutex);
+				if (error) {
+					std::rethrow_exception(error);
+				}
+				lck.unlock();
+
+				if (!popped) {
+					finished = true;
+					break;
+				}
+				currentPos = 0;
+				continue;
+			}
+
+			size_t n = std::min(size - n_total, current.data.size() - currentPos);
+			memcpy(dst + n_total, current.data.data() + currentPos, n);
+			n_total += n;
+			currentPos += n;
+		}
+
+		return n_total;
+	}
+};
+
+
+#ifndef NO_GZIP
+// *******************************************************************************************/
+class GzipInputStream : public CompressedInputStream {
+	z_stream strm;
+	bool inputEnded{ false };
+	bool inMember{ false };	// member started but its end not reached yet
+
+public:
+	GzipInputStream(const std::string& fileName) : CompressedInputStream(fileName) {
+		memset(&strm, 0, sizeof(strm));
+		if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+			throw std::runtime_error("Error decompressing input: zlib initialization failed");
+		}
+	}
+
+	~GzipInputStream() {
+		inflateEnd(&strm);
+	}
+
+	size_t read(char* dst, size_t size) override {
+		strm.next_out = (Bytef*)dst;
+		strm.avail_out = (uInt)size;
+
+		while (strm.avail_out > 0) {
+			if (strm.avail_in == 0) {
+				size_t n = inputEnded ? 0 : readCompressed();
+				if (n == 0) {
+					inputEnded = true;
+					if (inMember) {
+						throw std::runtime_error("Error decompressing input: truncated gzip input");
+					}
+					break;
+				}
+				strm.next_in = (Bytef*)inBuffer.data();
+				strm.avail_in = (uInt)n;
+			}
+
+			inMember = true;
+			int ret = inflate(&strm, Z_NO_FLUSH);
+			if (ret == Z_STREAM_END) {
+				// next member may follow
+				inflateReset(&strm);
+				inMember = false;
+			}
+			else if (ret != Z_OK) {
+				throw std::runtime_error("Error decompressing gzip input");
+			}
+		}
+
+		return size - strm.avail_out;
+	}
+};
+
+
+// *******************************************************************************************
+// BGZF: concatenation of gzip members (at most 64KB each) with sizes stored in the headers.
+// *******************************************************************************************
+class BgzfInputStream : public ParallelInputStream {
+
+	static const size_t HEADER_SIZE = 18;
+	static const size_t FOOTER_SIZE = 8;
+
+	static uint32_t load16(const char* p) { return (uint32_t)(uint8_t)p[0] | ((uint32_t)(uint8_t)p[1] << 8); }
+	static uint32_t load32(const char* p) { return load16(p) | (load16(p + 2) << 16); }
+
+public:
+	static bool isBgzf(const char* p, size_t n) {
+		return n >= HEADER_SIZE
+			&& (uint8_t)p[0] == 0x1f && (uint8_t)p[1] == 0x8b && p[2] == 8 && (p[3] & 4)	// gzip with FEXTRA
+			&& load16(p + 10) == 6 && p[12] == 'B' && p[13] == 'C' && load16(p + 14) == 2;	// BC subfield only
+	}
+
+	BgzfInputStream(const std::string& fileName, int numThreads) : ParallelInputStream(fileName, numThreads) {
+		start(numThreads);
+	}
+
+	~BgzfInputStream() {
+		stop();
+	}
+
+protected:
+	size_t unitSize(const char* p, size_t n) const override {
+		if (n < HEADER_SIZE) {
+			return 0;
+		}
+		if (!isBgzf(p, n)) {
+			throw std::runtime_error("Error decompressing input: invalid BGZF block");
+		}
+		return load16(p + 16) + 1;
+	}
+
+	void decompress(const char* src, size_t n, std::vector<char>& out) const override {
+		z_stream strm;
+		memset(&strm, 0, sizeof(strm));
+		inflateInit2(&strm, -MAX_WBITS); // raw deflate
+
+		for (const char* p = src; p < src + n; ) {
+			size_t size = load16(p + 16) + 1;
+			size_t isize = load32(p + size - 4);
+			size_t out_pos = out.size();
+			out.resize(out_pos + isize);
+
+			inflateReset(&strm);
+			strm.next_in = (Bytef*)(p + HEADER_SIZE);
+			strm.avail_in = (uInt)(size - HEADER_SIZE - FOOTER_SIZE);
+			strm.next_out = (Bytef*)(out.data() + out_pos);
+			strm.avail_out = (uInt)isize;
+
+			if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
+				inflateEnd(&strm);
+				throw std::runtime_error("Error decompressing input: invalid BGZF block");
+			}
+
+			p += size;
+		}
+
+		inflateEnd(&strm);
+	}
+};
+#endif
+
+
+#ifndef NO_ZSTD
+// *******************************************************************************************/
+class ZstdInputStream : public CompressedInputStream {
+	ZSTD_DCtx* dctx;
+	ZSTD_inBuffer in{ nullptr, 0, 0 };
+	bool inFrame{ false };	// frame started but its end not reached yet
+
+public:
+	ZstdInputStream(const std::string& fileName) : CompressedInputStream(fileName) {
+		dctx = ZSTD_createDCtx();
+	}
+
+	~ZstdInputStream() {
+		ZSTD_freeDCtx(dctx);
+	}
+
+	size_t read(char* dst, size_t size) override {
+		ZSTD_outBuffer out{ dst, size, 0 };
+
+		while (out.pos < out.size) {
+			if (in.pos == in.size) {
+				size_t n = readCompressed();
+				if (n == 0) {
+					if (inFrame) {
+						throw std::runtime_error("Error decompressing input: truncated zstd input");
+					}
+					break;
+				}
+				in = ZSTD_inBuffer{ inBuffer.data(), n, 0 };
+			}
+
+			size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+			if (ZSTD_isError(ret)) {
+				throw std::runtime_error(std::string("Error decompressing zstd input: ") + ZSTD_getErrorName(ret));
+			}
+			inFrame = (ret != 0); // 0 when a frame is completely decoded and flushed
+		}
+
+		return out.pos;
+	}
+};
+
+
+// *******************************************************************************************
+// Multi-frame zstd files (e.g., produced by pzstd) have independent frames.
+// *******************************************************************************************
+class ZstdFramesInputStream : public ParallelInputStream {
+
+public:
+	// Checks if the first frame is complete within given data.
+	static bool isMultiFrame(const char* p, size_t n, size_t fileSize) {
+		size_t ret = ZSTD_findFrameCompressedSize(p, n);
+		return !ZSTD_isError(ret) && ret < fileSize;
+	}
+
+	ZstdFramesInputStream(const std::string& fileName, int numThreads) : ParallelInputStream(fileName, numThreads) {
+		start(numThreads);
+	}
+
+	~ZstdFramesInputStream() {
+		stop();
+	}
+
+protected:
+	size_t unitSize(const char* p, size_t n) const override {
+		size_t ret = ZSTD_findFrameCompressedSize(p, n);
+		if (ZSTD_isError(ret)) {
+			if (ZSTD_getErrorCode(ret) == ZSTD_error_srcSize_wrong) {
+				return 0;
+			}
+			throw std::runtime_error(std::string("Error decompressing zstd input: ") + ZSTD_getErrorName(ret));
+		}
+		return ret;
+	}
+
+	void decompress(const char* src, size_t n, std::vector<char>& out) const override {
+		ZSTD_DCtx* dctx = ZSTD_createDCtx();
+		ZSTD_inBuffer in{ src, n, 0 };
+		out.resize(std::max(n * 4, ZSTD_DStreamOutSize()));
+		ZSTD_outBuffer o{ out.data(), out.size(), 0 };
+
+		while (in.pos < in.size) {
+			if (o.pos == o.size) {
+				out.resize(out.size() * 2);
+				o.dst = out.data();
+				o.size = out.size();
+			}
+
+			size_t ret = ZSTD_decompressStream(dctx, &o, &in);
+			if (ZSTD_isError(ret)) {
+				ZSTD_freeDCtx(dctx);
+				throw std::runtime_error(std::string("Error decompressing zstd input: ") + ZSTD_getErrorName(ret));
+			}
+		}
+
+		// flush data remaining in the context
+		size_t ret = 1;
+		while (ret != 0) {
+			if (o.pos == o.size) {
+				out.resize(out.size() * 2);
+				o.dst = out.data();
+				o.size = out.size();
+			}
+			ret = ZSTD_decompressStream(dctx, &o, &in);
+			if (ZSTD_isError(ret) || (ret != 0 && o.pos < o.size)) {
+				break;
+			}
+		}
+
+		out.resize(o.pos);
+		ZSTD_freeDCtx(dctx);
+	}
+};
+#endif
+
+
+// *******************************************************************************************
+bool InputStream::getline(std::string& line) {
+	line.clear();
+	char c;
+	size_t n;
+	while ((n = read(&c, 1)) == 1 && c != '\n') {
+		line.push_back(c);
+	}
+
+	return n == 1 || !line.empty();
+}
+
+// *******************************************************************************************
+Compression InputStream::detectCompression(const std::string& fileName) {
+	std::ifstream ifs(fileName, ios_base::binary);
+	uint8_t magic[4]{ 0, 0, 0, 0 };
+	ifs.read((char*)magic, 4);
+
+	if (ifs.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+		return Compression::Gzip;
+	}
+	if (ifs.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+		return Compression::Zstd;
+	}
+
+	return Compression::None;
+}
+
+// *******************************************************************************************
+std::unique_ptr<InputStream> InputStream::open(const std::string& fileName, int numThreads) {
+
+	Compression compression = detectCompression(fileName);
+
+	if (compression == Compression::None) {
+		return std::make_unique<FileInputStream>(fileName);
+	}
+
+	// examine the beginning of the file to check whether it can be decompressed in parallel
+	std::ifstream ifs(fileName, ios_base::binary | ios_base::ate);
+	size_t fileSize = ifs.tellg();
+	ifs.seekg(0);
+	std::vector<char> head(std::min<size_t>(fileSize, 64ULL << 20));
+	ifs.read(head.data(), head.size());
+	ifs.close();
+
+	if (compression == Compression::Gzip) {
+#ifdef NO_GZIP
+		throw std::runtime_error("Gzip-compressed input not supported (Clusty built without zlib)");
+#else
+		if (BgzfInputStream::isBgzf(head.data(), head.size())) {
+			LOG_VERBOSE << "BGZF input - parallel decompression" << endl;
+			return std::make_unique<BgzfInputStream>(fileName, numThreads);
+		}
+		LOG_VERBOSE << "gzip input - serial decompression" << endl;
+		return std::make_unique<GzipInputStream>(fileName);
+#endif
+	}
+	else {
+#ifdef NO_ZSTD
+		throw std::runtime_error("Zstd-compressed input not supported (Clusty built without zstd)");
+#else
+		if (ZstdFramesInputStream::isMultiFrame(head.data(), head.size(), fileSize)) {
+			LOG_VERBOSE << "multi-frame zstd input - parallel decompression" << endl;
+			return std::make_unique<ZstdFramesInputStream>(fileName, numThreads);
+		}
+		LOG_VERBOSE << "zstd input - serial decompression" << endl;
+		return std::make_unique<ZstdInputStream>(fileName);
+#endif
+	}
+}
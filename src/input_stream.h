@@ -0,0 +1,41 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+// *******************************************************************************************/
+enum class Compression {
+	None,
+	Gzip,
+	Zstd
+};
+
+// *******************************************************************************************
+// Sequential source of (decompressed) bytes of an input file.
+// *******************************************************************************************
+class InputStream {
+public:
+	virtual ~InputStream() {}
+
+	// Reads up to size bytes into dst. Less bytes are returned only at the end of data.
+	virtual size_t read(char* dst, size_t size) = 0;
+
+	// Reads a single line (without a newline character).
+	bool getline(std::string& line);
+
+	// Recognizes compression by the magic number.
+	static Compression detectCompression(const std::string& fileName);
+
+	// Creates stream appropriate for the file. Members of BGZF files and frames of multi-frame
+	// zstd files are decompressed in parallel by numThreads workers.
+	static std::unique_ptr<InputStream> open(const std::string& fileName, int numThreads);
+};
@@ -25,7 +25,8 @@ public:
 
 public:
 
-	InputBuffer(size_t size) : size(size), data(new char[size + 1]), block_begin(data), block_end(nullptr) {}
+	// padding allows word-wise parsing of the last field
+	InputBuffer(size_t size) : size(size), data(new char[size + 16]), block_begin(data), block_end(nullptr) {}
 	~InputBuffer() { delete[] data; }
 };
 
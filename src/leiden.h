@@ -29,6 +29,7 @@ class Leiden : public IClustering<Distance> {
 
 private:
 	LeidenParams params;
+	bool preserveMatrix{ false };
 
 public:
 
@@ -51,6 +52,17 @@ public:
 #else
 	
 	Leiden(const LeidenParams& params) : params(params) {}
+
+	std::vector<int> clusterThresholds(
+		SparseMatrix<Distance>& distances,
+		const std::vector<int>& objects,
+		const std::vector<double>& thresholds,
+		std::vector<std::vector<int>>& assignments) override {
+		
+		// matrix is needed for all thresholds
+		preserveMatrix = true;
+		return IClustering<Distance>::clusterThresholds(distances, objects, thresholds, assignments);
+	}
 	
 	int operator()(
 		SparseMatrix<Distance>& distances,
@@ -62,7 +74,7 @@ public:
 		igraph_t g;
 		igraph_vector_t edge_weights;
 
-		load_graph(distances, g, edge_weights);
+		load_graph(distances, threshold, g, edge_weights);
 
 		igraph_integer_t n_clusters;
 		igraph_vector_int_t memb_vec;
@@ -82,7 +94,7 @@ public:
 	}
 
 
-	void load_graph(SparseMatrix<Distance>& matrix, igraph_t& g, igraph_vector_t& edge_weights) {
+	void load_graph(SparseMatrix<Distance>& matrix, double threshold, igraph_t& g, igraph_vector_t& edge_weights) {
 
 		igraph_vector_int_t edges;
 		igraph_vector_int_init(&edges, 0);
@@ -91,14 +103,21 @@ public:
 
 		for (int i = 0; i < matrix.num_objects(); ++i) {
 			for (const Distance* edge = matrix.begin(i); edge < matrix.end(i); ++edge) {
-				if (i < edge->get_id()) {
+				if (i < edge->get_id() && edge->get_d() <= threshold) {
 					igraph_vector_int_push_back(&edges, i);
 					igraph_vector_int_push_back(&edges, edge->get_id());
 					igraph_vector_push_back(&edge_weights, 1.0 - edge->get_d());
 				}
 			}
 
-			matrix.clear_row(i);
+			// segments of rows already copied to igraph vectors are released
+			if (!preserveMatrix && i + 1 == matrix.segment_last_row(matrix.segment_of(i))) {
+				matrix.release_segment(matrix.segment_of(i));
+			}
+		}
+
+		if (!preserveMatrix) {
+			matrix.clear_rows();
 		}
 
 		igraph_empty(&g, matrix.num_objects(), IGRAPH_UNDIRECTED);
@@ -18,6 +18,7 @@
 #include <memory>
 #include <vector>
 #include <sstream>
+#include <algorithm>
 
 #include "clustering.h"
 #include "distances.h"
@@ -25,6 +26,15 @@
 #include "utils.h" 
 #include "memory_monotonic.h"
 #include "log.h"
+#include "union_find.h"
+
+#include <thread>
+#include <atomic>
+#include <queue>
+#include <tuple>
+#include <functional>
+#include <numeric>
+#include <bit>
 
 namespace linkage_algorithm_heaptrix
 {
@@ -59,7 +69,51 @@ namespace linkage_algorithm_heaptrix
    }
 
 
-   template <class Distance, typename AggregationRule>
+   /** Arena of blocks for row tables. Sizes of blocks are powers of two multiplied by the size
+    *  of a slot. Blocks given back are reused by tables of the same size, the whole memory is 
+    *  freed at once by release(). */
+   class table_arena
+   {
+      refresh::memory_monotonic_unsafe _memory;
+      std::vector<std::vector<char*>> _free_blocks; // indexed by log2 of the number of slots
+      std::size_t _bytes_per_slot;
+
+      public:
+      table_arena (const std::size_t bytes_per_slot) : _memory(16 << 20, 64), _bytes_per_slot(bytes_per_slot) {}
+
+      char* allocate (const int log_size)
+      {
+         if (log_size < (int) _free_blocks.size() and not _free_blocks[log_size].empty())
+         {
+            char* p = _free_blocks[log_size].back();
+            _free_blocks[log_size].pop_back();
+            return p;
+         }
+
+         return (char*) _memory.allocate(_bytes_per_slot << log_size);
+      }
+
+      void free (char* p, const int log_size)
+      {
+         if (log_size >= (int) _free_blocks.size())
+            _free_blocks.resize(log_size + 1);
+
+         _free_blocks[log_size].push_back(p);
+      }
+
+      void release ()
+      {
+         _free_blocks.clear();
+         _memory.release();
+      }
+   };
+
+   /** Heap policies of the linkage: binary heap of all elements or a monotone bucket queue 
+    *  keyed on distances quantised in [0,1]. Both give the same order of merges. */
+   struct binary_heap_policy {};
+   struct bucket_heap_policy {};
+
+   template <class Distance, typename AggregationRule, typename HeapPolicy = binary_heap_policy>
       class linkage : public HierarchicalClustering<Distance> 
    {
       const std::size_t MAX_SIZE_T = std::numeric_limits<std::size_t>::max(); // Index of the location in the heap. MAX means no index set.
@@ -114,47 +168,122 @@ namespace linkage_algorithm_heaptrix
       };
       #pragma pack(pop)
 
+      /** Row of the matrix: open-addressing table with linear probing. Column identifiers and
+       *  values are stored inline in slots, so probes never leave the table. Pointers to elements,
+       *  needed only to update the heap, are kept in a parallel array. Both arrays share one 
+       *  block of the table arena. */
       class matrix_row_ht
       {
       public:
-          using ht_elem_t = std::pair<std::size_t, element*>;
-
-      private:
-          static constexpr size_t empty = std::numeric_limits<std::size_t>::max();
-          static constexpr size_t removed = std::numeric_limits<std::size_t>::max() - 1;
+          struct slot
+          {
+              uint32_t column;
+              double value;
+          };
 
-          std::vector<ht_elem_t> ht;
+          static constexpr std::size_t BYTES_PER_SLOT = sizeof(slot) + sizeof(element*);
 
-          double max_fill_factor;
-          size_t ht_size;
-          size_t ht_filled;
-          size_t ht_mask;
-          size_t when_restruct;
+          /// Entry of the table (only live ones are visited by iterators).
+          struct entry
+          {
+              std::size_t column;
+              double value;
+              element* ptr;
+          };
 
-          std::size_t determine_size(std::size_t req_size)
+          class iterator
           {
-              std::size_t s = (std::size_t)(req_size / max_fill_factor);
-              while (s & (s - 1))
-                  s &= s - 1;
+              const matrix_row_ht* ht;
+              std::size_t pos;
 
-              return 2 * s;
-          }
+              void skip_free()
+              {
+                  while (pos < ht->ht_size && ht->slots[pos].column >= removed)
+                      ++pos;
+              }
 
-          void restruct()
+          public:
+              iterator(const matrix_row_ht* ht, std::size_t pos) : ht(ht), pos(pos) { skip_free(); }
+
+              entry operator*() const { return entry{ ht->slots[pos].column, ht->slots[pos].value, ht->ptrs[pos] }; }
+
+              iterator& operator++() { ++pos; skip_free(); return *this; }
+
+              bool operator!=(const iterator& rhs) const { return pos != rhs.pos; }
+          };
+
+      private:
+          static constexpr uint32_t empty = std::numeric_limits<uint32_t>::max();
+          static constexpr uint32_t removed = std::numeric_limits<uint32_t>::max() - 1;
+          static constexpr int min_log_size = 3;
+          static constexpr double max_fill_factor = 0.8;
+
+          table_arena* arena;
+          slot* slots = nullptr;
+          element** ptrs = nullptr;
+
+          int log_size = 0;             // 0 when there is no storage
+          std::size_t ht_size = 0;
+          std::size_t ht_mask = 0;
+          std::size_t ht_filled = 0;    // live and removed slots
+          std::size_t ht_live = 0;
+          std::size_t when_restruct = 0;
+
+          void allocate(int new_log_size)
           {
-              std::vector<ht_elem_t> ht_old(std::move(ht));
+              char* block = arena->allocate(new_log_size);
 
-              ht.clear();
-              ht_size *= 2;
+              log_size = new_log_size;
+              ht_size = std::size_t(1) << log_size;
               ht_mask = ht_size - 1;
               when_restruct = (std::size_t)(ht_size * max_fill_factor);
               ht_filled = 0;
+              ht_live = 0;
 
-              ht.resize(ht_size, std::make_pair(empty, nullptr));
+              slots = reinterpret_cast<slot*>(block);
+              ptrs = reinterpret_cast<element**>(block + sizeof(slot) * ht_size);
 
-              for (const auto& [idx, ptr] : ht_old)
-                  if (ptr)
-                      insert(idx, ptr);
+              for (std::size_t i = 0; i < ht_size; ++i)
+                  slots[i].column = empty;
+          }
+
+          void restruct()
+          {
+              slot* old_slots = slots;
+              element** old_ptrs = ptrs;
+              int old_log_size = log_size;
+              std::size_t old_size = ht_size;
+
+              // table filled mostly with removed slots is only cleaned up
+              if (old_log_size == 0)
+                  allocate(min_log_size);
+              else if (2 * ht_live < when_restruct)
+                  allocate(old_log_size);
+              else
+                  allocate(old_log_size + 1);
+
+              for (std::size_t i = 0; i < old_size; ++i)
+                  if (old_slots[i].column < removed)
+                      place(old_slots[i].column, old_slots[i].value, old_ptrs[i]);
+
+              if (old_log_size)
+                  arena->free(reinterpret_cast<char*>(old_slots), old_log_size);
+          }
+
+          void place(uint32_t idx, double value, element* ptr)
+          {
+              auto pos = hash_mm(idx) & ht_mask;
+
+              while (slots[pos].column < removed)
+                  pos = (pos + 1) & ht_mask;
+
+              if (slots[pos].column == empty)
+                  ++ht_filled;
+
+              slots[pos].column = idx;
+              slots[pos].value = value;
+              ptrs[pos] = ptr;
+              ++ht_live;
           }
 
           // MurMur3 hash
@@ -169,152 +298,136 @@ namespace linkage_algorithm_heaptrix
               return x;
           }
 
-      public:
-          matrix_row_ht(std::size_t init_size = 8, double max_fill_factor = 0.8) :
-              max_fill_factor(max_fill_factor)
+          void steal(matrix_row_ht& rhs)
           {
-              ht_size = determine_size(init_size) / 2;
-              ht_mask = ht_size - 1;
+              arena = rhs.arena;
+              slots = rhs.slots;
+              ptrs = rhs.ptrs;
+              log_size = rhs.log_size;
+              ht_size = rhs.ht_size;
+              ht_mask = rhs.ht_mask;
+              ht_filled = rhs.ht_filled;
+              ht_live = rhs.ht_live;
+              when_restruct = rhs.when_restruct;
 
-              // Enforce init at first insert
-              when_restruct = 0;
-              ht_filled = 0;
+              rhs.slots = nullptr;
+              rhs.ptrs = nullptr;
+              rhs.log_size = 0;
+              rhs.ht_size = rhs.ht_mask = rhs.ht_filled = rhs.ht_live = rhs.when_restruct = 0;
           }
 
+      public:
+          matrix_row_ht(table_arena* arena = nullptr) : arena(arena) {}
+
+          /// Storage is owned by the arena, thus it is not given back on destruction.
+          ~matrix_row_ht() {}
+
           matrix_row_ht(matrix_row_ht&& rhs) noexcept
           {
-              ht = move(rhs.ht);
+              steal(rhs);
+          }
 
-              max_fill_factor = rhs.max_fill_factor;
-              ht_size = rhs.ht_size;
-              ht_filled = rhs.ht_filled;
-              ht_mask = rhs.ht_mask;
-              when_restruct = rhs.when_restruct;
+          matrix_row_ht(const matrix_row_ht& rhs) : arena(rhs.arena)
+          {
+              *this = rhs;
           }
 
-          matrix_row_ht& operator=(matrix_row_ht&& rhs) 
+          matrix_row_ht& operator=(matrix_row_ht&& rhs) noexcept
           {
               if (this == &rhs)
                   return *this;
 
-              ht = move(rhs.ht);
-
-              max_fill_factor = rhs.max_fill_factor;
-              ht_size = rhs.ht_size;
-              ht_filled = rhs.ht_filled;
-              ht_mask = rhs.ht_mask;
-              when_restruct = rhs.when_restruct;
+              clear();
+              steal(rhs);
 
               return *this;
           }
 
-          matrix_row_ht& operator=(const matrix_row_ht& rhs) 
+          matrix_row_ht& operator=(const matrix_row_ht& rhs)
           {
               if (this == &rhs)
                   return *this;
 
-              ht = rhs.ht;
+              clear();
+              arena = rhs.arena;
 
-              max_fill_factor = rhs.max_fill_factor;
-              ht_size = rhs.ht_size;
-              ht_filled = rhs.ht_filled;
-              ht_mask = rhs.ht_mask;
-              when_restruct = rhs.when_restruct;
+              if (rhs.log_size)
+              {
+                  allocate(rhs.log_size);
+                  std::copy_n(rhs.slots, ht_size, slots);
+                  std::copy_n(rhs.ptrs, ht_size, ptrs);
+                  ht_filled = rhs.ht_filled;
+                  ht_live = rhs.ht_live;
+              }
 
               return *this;
           }
 
-          void insert(size_t idx, element* ptr)
+          void insert(std::size_t idx, element* ptr)
           {
               if (ht_filled == when_restruct)
                   restruct();
 
-              auto pos = hash_mm(idx) & ht_mask;
-
-              while (true)
-              {
-                  if (ht[pos].second == nullptr)
-                      break;
-
-                  pos = (pos + 1) & ht_mask;
-              }        
-
-              ht[pos].first = idx;
-              ht[pos].second = ptr;
-
-              ++ht_filled;
+              place((uint32_t)idx, ptr->_value, ptr);
           }
 
-          typename std::vector<matrix_row_ht::ht_elem_t>::iterator find(size_t idx)
+          /// @return slot with the column or nullptr if there is no such.
+          const slot* find(std::size_t idx) const
           {
-              if (ht_filled == 0)
-                  return ht.end();
+              if (ht_live == 0)
+                  return nullptr;
 
               auto pos = hash_mm(idx) & ht_mask;
 
               while (true)
               {
-                  if (ht[pos].first == idx)
-                      return ht.begin() + pos;
+                  if (slots[pos].column == idx)
+                      return slots + pos;
 
-                  if (ht[pos].first == empty)
-                      return ht.end();
+                  if (slots[pos].column == empty)
+                      return nullptr;
 
                   pos = (pos + 1) & ht_mask;
               }
           }
 
-          void erase(typename std::vector<matrix_row_ht::ht_elem_t>::iterator it)
+          void erase(std::size_t idx)
           {
-              it->first = removed;
-              it->second = nullptr;
-          }
+              const slot* p = find(idx);
 
-          void erase(size_t idx)
-          {
-              if (ht_filled == 0)
+              if (p == nullptr)
                   return;
 
-              auto pos = hash_mm(idx) & ht_mask;
-
-              while (true)
-              {
-                  if (ht[pos].first == idx)
-                  {
-                      ht[pos].first = removed;
-                      ht[pos].second = nullptr;
-                      return;
-                  }
-
-                  if (ht[pos].first == empty)
-                      return;
-
-                  pos = (pos + 1) & ht_mask;
-              }
+              auto pos = p - slots;
+              slots[pos].column = removed;
+              ptrs[pos] = nullptr;
+              --ht_live;
           }
 
-          typename std::vector<matrix_row_ht::ht_elem_t>::iterator begin()
+          iterator begin() const
           {
-              return ht.begin();
+              return iterator(this, 0);
           }
 
-          typename std::vector<matrix_row_ht::ht_elem_t>::iterator end()
+          iterator end() const
           {
-              return ht.end();
+              return iterator(this, ht_size);
           }
 
           void clear()
           {
-              ht_size = 8;
-              when_restruct = 0;
-              ht_filled = 0;
-              ht.clear();
-              ht.shrink_to_fit();
+              if (log_size)
+                  arena->free(reinterpret_cast<char*>(slots), log_size);
+
+              slots = nullptr;
+              ptrs = nullptr;
+              log_size = 0;
+              ht_size = ht_mask = ht_filled = ht_live = when_restruct = 0;
           }
 
           void prefetch()
           {
-              _my_prefetch(ht.data());
+              _my_prefetch(slots);
           }
       };
 
@@ -324,23 +437,12 @@ namespace linkage_algorithm_heaptrix
          std::size_t id; // index
          matrix_row_ht _values; 
 
-         matrix_row() : id(std::numeric_limits<std::size_t>::max()) {  }
-         matrix_row(std::size_t id) : id(id) {  }
+         matrix_row(std::size_t id, table_arena* arena) : id(id), _values(arena) {  }
 
          void clear() { _values.clear(); id = std::numeric_limits<std::size_t>::max(); }
 
-         matrix_row(const matrix_row& rhs)
-         {
-             id = rhs.id;
-             _values = rhs._values;
-         }
-
-         matrix_row(matrix_row&& rhs) noexcept
-         {
-             id = std::move(rhs.id);
-             _values = std::move(rhs._values);
-         };
-
+         matrix_row(const matrix_row& rhs) = default;
+         matrix_row(matrix_row&& rhs) noexcept = default;
          matrix_row& operator=(matrix_row&&) noexcept = default;
          matrix_row& operator=(const matrix_row&) = default;
       };
@@ -352,6 +454,9 @@ namespace linkage_algorithm_heaptrix
           
           std::vector<matrix_row> _rows;
 
+          /// Storage of row tables.
+          table_arena _arena { matrix_row_ht::BYTES_PER_SLOT };
+
          /** @return true, if the w-th row exists in the matrix.
           */ 
          bool exists_row(const std::size_t w)
@@ -368,7 +473,7 @@ namespace linkage_algorithm_heaptrix
             if (not exists_row(row))
                return false;
             else
-               return _rows[row]._values.find(col) != _rows[row]._values.end();
+               return _rows[row]._values.find(col) != nullptr;
          }
 
          bool add_row(const std::size_t w)
@@ -384,7 +489,7 @@ namespace linkage_algorithm_heaptrix
                  return true;
              }
                  
-             _rows.resize((std::size_t)(std::max<size_t>(w, 16) * 1.2), MAX_SIZE_T);
+             _rows.resize((std::size_t)(std::max<size_t>(w, 16) * 1.2), matrix_row(MAX_SIZE_T, &_arena));
              _rows[w].id = w;
 
              return true;
@@ -671,9 +776,242 @@ namespace linkage_algorithm_heaptrix
          }
       };
 
+      /** Monotone bucket queue. Elements are put into buckets by distances quantised in [0,1] 
+       *  (values outside go to the first and the last bucket). Aggregation rules never produce
+       *  values below the current minimum, so only the lowest non-empty bucket has to be ordered - 
+       *  it is kept as a binary heap with the same tie-breaking as in heap. Elements of other 
+       *  buckets are unordered and removed in O(1). Index of an element is its position in the
+       *  bucket. Non-empty buckets are tracked by a two-level bitmap. */
+      class bucket_heap
+      {
+         static constexpr int LOG_BUCKETS = 16;
+         static constexpr std::size_t N_BUCKETS = (std::size_t(1) << LOG_BUCKETS) + 1; // last one for values >= 1
+         static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+         std::vector<std::vector<element*>> _buckets; // grows up to the largest key
+         std::vector<uint64_t> _used;                 // non-empty buckets
+         std::vector<uint64_t> _summary;              // non-zero words of _used
+         std::size_t _size = 0;
+         std::size_t _current = 0;                    // ordered bucket, no elements below it
+
+         static std::size_t key (const double value)
+         {
+            if (not (value > 0.0))
+               return 0;
+            if (value >= 1.0)
+               return N_BUCKETS - 1;
+            return (std::size_t) (value * (double) (N_BUCKETS - 1));
+         }
+
+         void mark (const std::size_t k)
+         {
+            _used[k >> 6] |= uint64_t(1) << (k & 63);
+            _summary[k >> 12] |= uint64_t(1) << ((k >> 6) & 63);
+         }
+
+         void unmark (const std::size_t k)
+         {
+            _used[k >> 6] &= ~(uint64_t(1) << (k & 63));
+            if (_used[k >> 6] == 0)
+               _summary[k >> 12] &= ~(uint64_t(1) << ((k >> 6) & 63));
+         }
+
+         /// @return the first non-empty bucket not below k or NONE
+         std::size_t next_used (const std::size_t k) const
+         {
+            std::size_t w = k >> 6;
+            uint64_t bits = _used[w] & (~uint64_t(0) << (k & 63));
+
+            if (bits == 0)
+            {
+               std::size_t s = (w + 1) >> 6;
+               if (s >= _summary.size())
+                  return NONE;
+               
+               uint64_t sbits = _summary[s] & (~uint64_t(0) << ((w + 1) & 63));
+               while (sbits == 0)
+               {
+                  if (++s == _summary.size())
+                     return NONE;
+                  sbits = _summary[s];
+               }
+
+               w = (s << 6) + std::countr_zero(sbits);
+               bits = _used[w];
+            }
+
+            return (w << 6) + std::countr_zero(bits);
+         }
+
+         static bool less (const element* l, const element* p)
+         {
+            return *l < *p;
+         }
+
+         static void sift_up (std::vector<element*> & h, std::size_t child)
+         {
+            while (child > 0)
+            {
+               auto parent = (child - 1) / 2;
+               if (not less(h[child], h[parent]))
+                  return;
+
+               std::swap(h[child], h[parent]);
+               std::swap(h[child]->_index_heap, h[parent]->_index_heap);
+               child = parent;
+            }
+         }
+
+         static void sift_down (std::vector<element*> & h, std::size_t parent)
+         {
+            const std::size_t n = h.size();
+
+            while (2 * parent + 1 < n)
+            {
+               auto smaller_child = 2 * parent + 1;
+               if (smaller_child + 1 < n and less(h[smaller_child + 1], h[smaller_child]))
+                  ++smaller_child;
+
+               if (not less(h[smaller_child], h[parent]))
+                  return;
+
+               std::swap(h[smaller_child], h[parent]);
+               std::swap(h[smaller_child]->_index_heap, h[parent]->_index_heap);
+               parent = smaller_child;
+            }
+         }
+
+         static void heapify (std::vector<element*> & h)
+         {
+            for (std::size_t i = h.size() / 2; i-- > 0; )
+               sift_down(h, i);
+         }
+
+         void append (element* p, const std::size_t k)
+         {
+            if (k >= _buckets.size())
+               _buckets.resize(k + 1);
+
+            auto & b = _buckets[k];
+            if (b.empty())
+               mark(k);
+
+            p->_index_heap = b.size();
+            b.push_back(p);
+            ++_size;
+         }
+
+         public:
+         bucket_heap() : _used((N_BUCKETS + 63) / 64, 0), _summary(((N_BUCKETS + 63) / 64 + 63) / 64, 0) {}
+
+         std::size_t size() const 
+         {
+            return _size;
+         }
+
+         void reserve(std::size_t) {}
+
+         void clear()
+         {
+            for (std::size_t k = _size ? next_used(0) : NONE; k != NONE; k = next_used(k))
+            {
+               _buckets[k].clear();
+               unmark(k);
+            }
+            _size = 0;
+            _current = 0;
+         }
+
+         /// The method ONLY adds an item WITHOUT ordering the lowest bucket. 
+         void push_back(element* p)
+         {
+            append(p, key(p->_value));
+         }
+
+         void make_heap ()
+         {
+            _current = _size ? next_used(0) : 0;
+            if (_size)
+               heapify(_buckets[_current]);
+         }
+
+         bool empty () const 
+         {
+            return _size == 0;
+         }
+
+         /// @return element on the top (does not remove it from the heap).
+         element* top()
+         {
+            if (_buckets[_current].empty())
+            {
+               _current = next_used(_current);
+               heapify(_buckets[_current]);
+            }
+
+            return _buckets[_current].front();
+         }
+
+         void insert(element* p)
+         {
+            const std::size_t k = key(p->_value);
+
+            // lower buckets are empty, so the new one is trivially ordered
+            if (k < _current)
+               _current = k;
+
+            append(p, k);
+
+            if (k == _current)
+               sift_up(_buckets[k], p->_index_heap);
+         }
+
+         void remove(const element* p)
+         {
+            if (p == nullptr)
+               return;
+
+            const std::size_t k = key(p->_value);
+            auto & b = _buckets[k];
+            const std::size_t index = p->_index_heap;
+
+            b[index] = b.back();
+            b[index]->_index_heap = index;
+            b.pop_back();
+            --_size;
+
+            if (b.empty())
+               unmark(k);
+            else if (k == _current and index < b.size())
+            {
+               sift_up(b, index);
+               sift_down(b, b[index]->_index_heap);
+            }
+         }
+
+         void replace(const element* p_old, element* p_new)
+         {
+            remove(p_old);
+            insert(p_new);
+         }
+
+         /// @return element on the top and remove it from the heap
+         element* pop()
+         {
+            if (empty())
+               return nullptr;
+
+            element* returned_value = top();
+            remove(returned_value);
+            return returned_value;
+         }
+      };
+
+      using heap_type = std::conditional_t<std::is_same_v<HeapPolicy, bucket_heap_policy>, bucket_heap, heap>;
+
       matrix _matrix;
       dendrogram _dendrogram;
-      heap _heap;
+      heap_type _heap;
       refresh::memory_monotonic_unsafe *mma;
       std::vector<element*> mma_buf;
 
@@ -774,29 +1112,64 @@ namespace linkage_algorithm_heaptrix
        
          _heap.reserve((std::size_t)(1.1 * m.num_elements()));
 
+         // input segments are released as soon as they are copied into the heap
          for (size_t i = 0; i < m.num_objects(); ++i) {
              
              for (const Distance* p = m.begin(i); p < m.end(i); ++p) {
                  const Distance& edge = *p;
-                 if (edge.get_d() != MAX_DOUBLE and edge.get_d() != INF_DOUBLE and i != edge.get_id())
+                   if (is_used(i, edge))
                      add_value(i, edge.get_id(), edge.get_d());
              }
 
-             m.clear_row(i);
+             if ((int) i + 1 == m.segment_last_row(m.segment_of((int) i)))
+                m.release_segment(m.segment_of((int) i));
          }
 
+         m.clear_rows();
+
          _heap.make_heap();
       };
 
       protected:
       AggregationRule aggregation;
 
+      /// Sizes of groups indexed by their identifiers.
+      std::vector<std::size_t> _sizes;
+
+      /// Number of objects (identifiers of groups start after them).
+      std::size_t _n_objects = 0;
+
+      /// Merges above this value are not needed (dendrogram is cut below it).
+      double _stop_threshold = std::numeric_limits<double>::infinity();
+
+      /** For rules which never decrease (complete linkage), a value above the stop threshold 
+       *  cannot take part in any needed merge, so it can be treated as absent. */
+      bool is_pruned (const double value) const
+      {
+         return AggregationRule::never_decreases and value > _stop_threshold;
+      }
+
+      /// @return true, if the edge from the row takes part in the clustering.
+      bool is_used (const std::size_t row, const Distance & edge) const
+      {
+         return edge.get_d() != MAX_DOUBLE and edge.get_d() != INF_DOUBLE and row != edge.get_id() and not is_pruned(edge.get_d());
+      }
+
+      /// Number of threads clustering components.
+      int _num_threads = 1;
+
       protected:
       void do_clustering()
       {
-         std::size_t id_of_the_next_group = _matrix.get_max_row() + 1; // id of aggregated group
+         // id of aggregated group (objects without edges, e.g., pruned ones, may follow the last row)
+         std::size_t id_of_the_next_group = _matrix.get_max_row() + 1;
+         if (_matrix.get_max_row() == MAX_SIZE_T or id_of_the_next_group < _n_objects)
+            id_of_the_next_group = _n_objects;
          std::size_t number_of_objects = id_of_the_next_group;
 
+         // numbers of objects in groups (for size-aware rules)
+         _sizes.assign(id_of_the_next_group, 1);
+
          //std::cerr << std::endl;
 
          std::vector<element*> merged_column;
@@ -813,6 +1186,10 @@ namespace linkage_algorithm_heaptrix
             std::size_t c_min = pMinimal->_column; // index of a row to merge
             double minimal_distance = pMinimal->_value;     // minimal distance
 
+            // merges are monotonic - the remaining ones are above the cut
+            if (minimal_distance > _stop_threshold)
+               break;
+
             // r_min should be less than k_min – for easier merging
             if (r_min > c_min)
                std::swap(r_min, c_min);
@@ -821,29 +1198,32 @@ namespace linkage_algorithm_heaptrix
             group g {id_of_the_next_group, _matrix._rows[r_min].id, _matrix._rows[c_min].id, minimal_distance };
             _dendrogram.groups.push_back(g); 
 
+            const std::size_t n_r = _sizes[r_min];
+            const std::size_t n_c = _sizes[c_min];
+            _sizes.push_back(n_r + n_c);
+
             ///////////////////////
             // merge matrix rows
-            matrix_row merged_row(id_of_the_next_group);  
+            matrix_row merged_row(id_of_the_next_group, &_matrix._arena);  
 
             merged_column.clear();
 
             heap_insert_buffer.clear();
 
             // Iterate all values in r_min row and merge:
-            for (const auto & [column_id, p] : _matrix._rows[r_min]._values)
+            for (const auto & [column_id, value, p] : _matrix._rows[r_min]._values)
             {
-                if (!p)                 // need for custom HT
-                    continue;
-
                 if (column_id == c_min)
                     continue;
 
                // Is the a counterpart in c_min row?
                auto it = _matrix._rows[c_min]._values.find(column_id);
-               if (it != _matrix._rows[c_min]._values.end())
+               if (it != nullptr)
                {
                   // Yes, there is – merge!
-                  double merged = aggregation (p->_value, (*it).second->_value);
+                  double merged = aggregation (value, n_r, it->value, n_c);
+                  if (is_pruned(merged))
+                     continue;
                   auto pNew = element_allocate(column_id, id_of_the_next_group, MAX_SIZE_T, merged); // new element for the merged column
                   heap_insert_buffer.emplace_back(pNew);
 
@@ -853,8 +1233,8 @@ namespace linkage_algorithm_heaptrix
                else // it == end
                {
                   // There is no finite counterpart.
-                  double merged = aggregation (p->_value, MAX_DOUBLE);
-                  if (merged != MAX_DOUBLE)
+                  double merged = aggregation (value, n_r, MAX_DOUBLE, n_c);
+                  if (merged != MAX_DOUBLE and not is_pruned(merged))
                   {
                      auto pNew = element_allocate(column_id, id_of_the_next_group, MAX_SIZE_T, merged);
                      heap_insert_buffer.emplace_back(pNew);
@@ -865,24 +1245,21 @@ namespace linkage_algorithm_heaptrix
                }
             }
             // Iterate all values in c_min row and merge: 
-            for (const auto & [column_id, p] : _matrix._rows[c_min]._values)
+            for (const auto & [column_id, value, p] : _matrix._rows[c_min]._values)
             {
-                if (!p)                 // need for custom HT
-                    continue;
-
                 if (column_id == r_min)
                     continue;
                 
                 // Is the a counterpart in c_min row?
                auto it = _matrix._rows[r_min]._values.find(column_id);
-               if (it == _matrix._rows[r_min]._values.end())
+               if (it == nullptr)
                {
                   // If there is a counterpart, it has already been merged in the loop above.
                   // If there is no counterpart, merge it!
 
                   // There is no finite counterpart.
-                  double merged = aggregation (MAX_DOUBLE, p->_value);
-                  if (merged != MAX_DOUBLE)
+                  double merged = aggregation (MAX_DOUBLE, n_r, value, n_c);
+                  if (merged != MAX_DOUBLE and not is_pruned(merged))
                   {
                      auto pNew = element_allocate(column_id, id_of_the_next_group, MAX_SIZE_T, merged);
                      heap_insert_buffer.emplace_back(pNew);
@@ -905,10 +1282,9 @@ namespace linkage_algorithm_heaptrix
 
             // remove rows r_min and c_min
             // first remove from the heap
-            for (const auto & [_, p] : _matrix._rows[r_min]._values)
+            for (const auto & e : _matrix._rows[r_min]._values)
             {
-                if (!p)                 // need for custom HT
-                    continue;
+                element* p = e.ptr;
 
                 auto c_row = r_min != p->_column ? p->_column : p->_row;
 
@@ -928,10 +1304,9 @@ namespace linkage_algorithm_heaptrix
             _matrix.prefetch_row_data(r_min);
             _matrix.prefetch_row_data(c_min);
 
-            for (const auto & [_, p] : _matrix._rows[c_min]._values)
+            for (const auto & e : _matrix._rows[c_min]._values)
             {
-                if (!p)                 // need for custom HT
-                    continue;
+                element* p = e.ptr;
                 
                 auto c_row = c_min != p->_column ? p->_column : p->_row;
 
@@ -961,6 +1336,14 @@ namespace linkage_algorithm_heaptrix
             heap_insert_buffer.clear();
          }
 
+         // elements left after early termination are freed with the memory pool
+         _heap.clear();
+         _matrix._rows.clear();
+         _matrix._rows.shrink_to_fit();
+         _matrix._arena.release();
+
+         std::vector<std::size_t>().swap(_sizes);
+
          mma->release();
          mma_buf.clear();
          mma_buf.shrink_to_fit();
@@ -1008,6 +1391,191 @@ namespace linkage_algorithm_heaptrix
          return _dendrogram;
       }
 
+      protected:
+      /** Loads a connected component with vertices given in ascending order. 
+       *  local_ids maps vertices of the matrix to their positions in the component. */
+      void read_component (SparseMatrix<Distance> & m, const int* vertices, const std::size_t n_vertices, const std::vector<int> & local_ids,
+         typename SparseMatrix<Distance>::segment_releaser & releaser)
+      {
+         _matrix._rows.clear();
+         _heap.clear();
+         _dendrogram.groups.clear();
+         _n_objects = n_vertices;
+
+         for (std::size_t i = 0; i < n_vertices; ++i)
+         {
+            std::size_t v = vertices[i];
+            for (const Distance* p = m.begin(v); p < m.end(v); ++p)
+               if (is_used(v, *p))
+                  add_value(i, local_ids[p->get_id()], p->get_d());
+            releaser.done((int) v);
+         }
+
+         _heap.make_heap();
+      }
+
+      public:
+      /** Clusters connected components of the graph independently on a thread pool (largest 
+       *  components first). Merges never join different components, thus the global sequence
+       *  of merges is obtained by interleaving sequences of components in the order the global 
+       *  heap would pop them - by (distance, left, right) with identifiers translated to the global 
+       *  ones. As the translation preserves the order of identifiers within a component, the 
+       *  result is identical to clustering of the whole graph. */
+      dendrogram do_clustering_components (SparseMatrix<Distance> & m)
+      {
+         ksi::clock stopwatch;
+         LOG_VERBOSE << "Splitting into components ";
+         stopwatch.start();
+
+         const int n_rows = (int) m.num_objects();
+         const int CHUNK_SIZE = 1024;
+         std::atomic<int> next_row {0};
+         ConcurrentUnionFind components (n_rows);
+         std::vector<std::thread> workers (_num_threads);
+
+         for (auto & w : workers)
+         {
+            w = std::thread([this, &m, &components, &next_row, n_rows, CHUNK_SIZE]() {
+               int first;
+               while ((first = next_row.fetch_add(CHUNK_SIZE)) < n_rows)
+               {
+                  for (int row = first; row < std::min(first + CHUNK_SIZE, n_rows); ++row)
+                     for (const Distance* p = m.begin(row); p < m.end(row); ++p)
+                        if ((int) p->get_id() > row and is_used(row, *p))
+                           components.unite(row, p->get_id());
+               }
+            });
+         }
+         for (auto & w : workers)
+            w.join();
+
+         // vertices of components with at least two elements (singletons have no edges)
+         std::vector<int> roots (n_rows), sizes (n_rows, 0), comp_ids (n_rows, -1);
+         for (int v = 0; v < n_rows; ++v)
+            ++sizes[roots[v] = components.find(v)];
+
+         std::vector<std::size_t> comp_offsets {0};
+         for (int v = 0; v < n_rows; ++v)
+         {
+            if (sizes[roots[v]] > 1 and comp_ids[roots[v]] == -1)
+            {
+               comp_ids[roots[v]] = (int) comp_offsets.size() - 1;
+               comp_offsets.push_back(comp_offsets.back() + sizes[roots[v]]);
+            }
+         }
+
+         const int n_comps = (int) comp_offsets.size() - 1;
+         std::vector<int> vertices (comp_offsets.back());
+         std::vector<int> local_ids (n_rows, -1);
+         std::vector<std::size_t> fill (comp_offsets.begin(), comp_offsets.end() - 1);
+
+         for (int v = 0; v < n_rows; ++v)
+         {
+            int c = comp_ids[roots[v]];
+            if (c != -1)
+            {
+               local_ids[v] = (int) (fill[c] - comp_offsets[c]);
+               vertices[fill[c]++] = v;
+            }
+         }
+
+         // input segments are released when all their rows are loaded into heaps
+         typename SparseMatrix<Distance>::segment_releaser releaser (m);
+         for (int v = 0; v < n_rows; ++v)
+            if (comp_ids[roots[v]] == -1)
+               releaser.done(v);
+
+         std::vector<int>().swap(roots);
+         std::vector<int>().swap(sizes);
+         std::vector<int>().swap(comp_ids);
+
+         std::vector<int> order (n_comps);
+         std::iota(order.begin(), order.end(), 0);
+         std::stable_sort(order.begin(), order.end(), [&comp_offsets](int a, int b) {
+            return comp_offsets[a + 1] - comp_offsets[a] > comp_offsets[b + 1] - comp_offsets[b];
+         });
+
+         stopwatch.stop();
+         LOG_VERBOSE << "done in " << (double) stopwatch.elapsed_milliseconds() / 1000 << " s ("
+            << n_comps << " components, the largest of " << (n_comps ? comp_offsets[order[0] + 1] - comp_offsets[order[0]] : 0) << " objects). ";
+
+         // cluster components (every worker reuses its own instance)
+         LOG_VERBOSE << "Performing linkage ";
+         stopwatch.start();
+
+         std::vector<std::vector<group>> comp_groups (n_comps);
+         std::atomic<int> next_comp {0};
+
+         for (auto & w : workers)
+         {
+            w = std::thread([this, &m, &order, &next_comp, &comp_offsets, &vertices, &local_ids, &comp_groups, &releaser, n_comps]() {
+               linkage engine;
+               engine._stop_threshold = _stop_threshold;
+
+               int k;
+               while ((k = next_comp++) < n_comps)
+               {
+                  int c = order[k];
+                  engine.read_component(m, vertices.data() + comp_offsets[c], comp_offsets[c + 1] - comp_offsets[c], local_ids, releaser);
+                  engine.do_clustering();
+                  comp_groups[c] = std::move(engine._dendrogram.groups);
+                  engine._dendrogram.groups.clear();
+               }
+            });
+         }
+         for (auto & w : workers)
+            w.join();
+
+         m.clear_rows();
+
+         // interleave merges of components
+         struct head {
+            double distance;
+            std::size_t left, right;
+            int comp;
+            bool operator > (const head & h) const { return std::tie(distance, left, right) > std::tie(h.distance, h.left, h.right); }
+         };
+
+         std::vector<std::vector<std::size_t>> group_ids (n_comps);
+         std::vector<std::size_t> positions (n_comps, 0);
+         std::priority_queue<head, std::vector<head>, std::greater<head>> heads;
+
+         auto global_id = [&](int c, std::size_t local) -> std::size_t {
+            std::size_t comp_size = comp_offsets[c + 1] - comp_offsets[c];
+            return local < comp_size ? vertices[comp_offsets[c] + local] : group_ids[c][local - comp_size];
+         };
+
+         auto push_head = [&](int c) {
+            if (positions[c] < comp_groups[c].size())
+            {
+               const group & g = comp_groups[c][positions[c]];
+               heads.push(head {g.distance, global_id(c, g.left), global_id(c, g.right), c});
+            }
+         };
+
+         for (int c = 0; c < n_comps; ++c)
+            push_head(c);
+
+         _dendrogram.groups.clear();
+         std::size_t id_of_the_next_group = _n_objects;
+
+         while (not heads.empty())
+         {
+            head h = heads.top();
+            heads.pop();
+
+            _dendrogram.groups.push_back(group {id_of_the_next_group, h.left, h.right, h.distance});
+            group_ids[h.comp].push_back(id_of_the_next_group++);
+            ++positions[h.comp];
+            push_head(h.comp);
+         }
+
+         stopwatch.stop();
+         LOG_VERBOSE << "done in " << (double) stopwatch.elapsed_milliseconds() / 1000 << " s. ";
+
+         return _dendrogram;
+      }
+
       protected:
       std::vector<node_t> makeDendrogram(const dendrogram & d, const std::size_t nObjects)
       {
@@ -1029,15 +1597,55 @@ namespace linkage_algorithm_heaptrix
             std::vector<int>& assignments
             )
       {
-         auto dendrogram = do_clustering(matrix);
+         _stop_threshold = this->keepDendrogram ? INF_DOUBLE : threshold;
+         _n_objects = objects.size();
+         auto dendrogram = do_clustering_components(matrix);
          std::vector<node_t> node_t_dendrogram = makeDendrogram(dendrogram, objects.size());
          assignments.resize(objects.size());
          int n_clusters = this->dendrogramToAssignments(node_t_dendrogram, threshold, assignments);
 
+         if (this->keepDendrogram)
+            this->lastDendrogram = std::move(node_t_dendrogram);
+
+         return n_clusters;
+      }
+
+      int operator() (
+            SparseMatrix<Distance>& matrix,
+            const std::vector<int>& objects,
+            double threshold,
+            std::vector<int>& assignments
+            ) override
+      {
+         return run(matrix, objects, threshold, assignments);
+      }
+
+      // Dendrogram does not depend on the threshold - build it once and cut at all thresholds.
+      std::vector<int> clusterThresholds (
+            SparseMatrix<Distance>& matrix,
+            const std::vector<int>& objects,
+            const std::vector<double>& thresholds,
+            std::vector<std::vector<int>>& assignments
+            ) override
+      {
+         _stop_threshold = (thresholds.empty() or this->keepDendrogram) ? INF_DOUBLE : *std::max_element(thresholds.begin(), thresholds.end());
+         _n_objects = objects.size();
+         auto dendrogram = do_clustering_components(matrix);
+         std::vector<node_t> node_t_dendrogram = makeDendrogram(dendrogram, objects.size());
+         
+         std::vector<int> n_clusters(thresholds.size());
+         assignments.assign(thresholds.size(), std::vector<int>(objects.size()));
+         
+         for (std::size_t i = 0; i < thresholds.size(); ++i)
+            n_clusters[i] = this->dendrogramToAssignments(node_t_dendrogram, thresholds[i], assignments[i]);
+
+         if (this->keepDendrogram)
+            this->lastDendrogram = std::move(node_t_dendrogram);
+
          return n_clusters;
       }
 
-      linkage()
+      linkage(int num_threads = 1) : _num_threads(std::max(num_threads, 1))
       {
           mma = new refresh::memory_monotonic_unsafe(16 << 20, std::max<size_t>(16, alignof(element)));
       }
@@ -1049,9 +1657,13 @@ namespace linkage_algorithm_heaptrix
       ////////////////
    };
 
+   /** Aggregation rules get values of the two merged groups (MAX means an absent, i.e., 
+    *  infinite, value) together with the sizes of the groups. */
    template<typename T>
    struct my_max {
-       T operator()(const T &x, const T &y) const
+       static constexpr bool never_decreases = true;
+
+       T operator()(const T &x, const std::size_t, const T &y, const std::size_t) const
        {
            return std::max<T>(x, y);
        }
@@ -1059,21 +1671,70 @@ namespace linkage_algorithm_heaptrix
    
    template<typename T>
    struct my_min {
-       T operator()(const T &x, const T &y) const
+       static constexpr bool never_decreases = false;
+
+       T operator()(const T &x, const std::size_t, const T &y, const std::size_t) const
        {
            return std::min<T>(x, y);
        }
    };
+
+   /** UPGMA - mean of all pairwise distances. An absent value stays absent, so that groups 
+    *  are merged only when all pairs are connected (as in complete linkage). */
+   template<typename T>
+   struct my_average {
+       static constexpr bool never_decreases = false;
+
+       T operator()(const T &x, const std::size_t n_x, const T &y, const std::size_t n_y) const
+       {
+           if (x == std::numeric_limits<T>::max() or y == std::numeric_limits<T>::max())
+               return std::numeric_limits<T>::max();
+
+           return (x * n_x + y * n_y) / (n_x + n_y);
+       }
+   };
+
+   /** WPGMA - both merged groups have the same weight regardless of their sizes. */
+   template<typename T>
+   struct my_weighted {
+       static constexpr bool never_decreases = false;
+
+       T operator()(const T &x, const std::size_t, const T &y, const std::size_t) const
+       {
+           if (x == std::numeric_limits<T>::max() or y == std::numeric_limits<T>::max())
+               return std::numeric_limits<T>::max();
+
+           return (x + y) / 2;
+       }
+   };
    
 
-   template <class Distance, typename AggregationRule = my_max<double>>
-      class complete_linkage : public linkage<Distance, AggregationRule>
+   template <class Distance, typename AggregationRule = my_max<double>, typename HeapPolicy = binary_heap_policy>
+      class complete_linkage : public linkage<Distance, AggregationRule, HeapPolicy>
+   {
+      public:
+      using linkage<Distance, AggregationRule, HeapPolicy>::linkage;
+   };
+
+   template <class Distance, typename HeapPolicy = binary_heap_policy>
+      class single_linkage : public linkage<Distance, my_min<double>, HeapPolicy> 
+   {
+      public:
+      using linkage<Distance, my_min<double>, HeapPolicy>::linkage;
+   };
+
+   template <class Distance, typename HeapPolicy = binary_heap_policy>
+      class average_linkage : public linkage<Distance, my_average<double>, HeapPolicy> 
    {
+      public:
+      using linkage<Distance, my_average<double>, HeapPolicy>::linkage;
    };
 
-   template <class Distance>
-      class single_linkage : public linkage<Distance, my_min<double>> 
+   template <class Distance, typename HeapPolicy = binary_heap_policy>
+      class weighted_linkage : public linkage<Distance, my_weighted<double>, HeapPolicy> 
    {
+      public:
+      using linkage<Distance, my_weighted<double>, HeapPolicy>::linkage;
    };
 }
 
@@ -1086,9 +1747,12 @@ inline std::ostream & operator << (std::ostream & sos, const std::vector<std::tu
    return sos;
 }
 
-template <class Distance>
-class SingleLinkage : public linkage_algorithm_heaptrix::single_linkage<Distance> 
+template <class Distance, class HeapPolicy = linkage_algorithm_heaptrix::binary_heap_policy>
+class SingleLinkage : public linkage_algorithm_heaptrix::single_linkage<Distance, HeapPolicy> 
 {
+public:
+   SingleLinkage(int numThreads = 1) : linkage_algorithm_heaptrix::single_linkage<Distance, HeapPolicy>(numThreads) {}
+
    int operator()
       (
        SparseMatrix<Distance>& distances,
@@ -1102,9 +1766,12 @@ class SingleLinkage : public linkage_algorithm_heaptrix::single_linkage<Distance
       }
 };
 
-template <class Distance>
-class CompleteLinkage : public linkage_algorithm_heaptrix::complete_linkage<Distance> 
+template <class Distance, class HeapPolicy = linkage_algorithm_heaptrix::binary_heap_policy>
+class CompleteLinkage : public linkage_algorithm_heaptrix::complete_linkage<Distance, linkage_algorithm_heaptrix::my_max<double>, HeapPolicy> 
 {
+public:
+   CompleteLinkage(int numThreads = 1) : linkage_algorithm_heaptrix::complete_linkage<Distance, linkage_algorithm_heaptrix::my_max<double>, HeapPolicy>(numThreads) {}
+
    int operator()
       (
        SparseMatrix<Distance>& distances,
@@ -1117,3 +1784,17 @@ class CompleteLinkage : public linkage_algorithm_heaptrix::complete_linkage<Dist
          return this->run (distances, objects, threshold, assignments);
       }
 };
+
+template <class Distance, class HeapPolicy = linkage_algorithm_heaptrix::binary_heap_policy>
+class AverageLinkage : public linkage_algorithm_heaptrix::average_linkage<Distance, HeapPolicy> 
+{
+public:
+   AverageLinkage(int numThreads = 1) : linkage_algorithm_heaptrix::average_linkage<Distance, HeapPolicy>(numThreads) {}
+};
+
+template <class Distance, class HeapPolicy = linkage_algorithm_heaptrix::binary_heap_policy>
+class WeightedLinkage : public linkage_algorithm_heaptrix::weighted_linkage<Distance, HeapPolicy> 
+{
+public:
+   WeightedLinkage(int numThreads = 1) : linkage_algorithm_heaptrix::weighted_linkage<Distance, HeapPolicy>(numThreads) {}
+};
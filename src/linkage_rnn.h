@@ -0,0 +1,602 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include "clustering.h"
+#include "distances.h"
+#include "clock.h"
+#include "log.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+
+// *******************************************************************************************
+// Hierarchical clustering by merging reciprocal nearest neighbours (RNN) in rounds.
+//
+// For reducible linkages (complete, average, weighted) a pair of clusters being mutual
+// nearest neighbours is merged by the sequential algorithm sooner or later, and merging
+// it does not change nearest neighbours of other pairs. Thus, all RNN pairs present in a
+// round can be merged at once, which gives the same dendrogram as heaptrix when distances
+// are unique. Ties are resolved by smaller identifiers of current clusters, while heaptrix 
+// takes the first (distance, row, column) entry over its own group identifiers. Therefore, 
+// in the presence of equal distances a different (equally valid) pair may be merged and 
+// the resulting clusters may differ from the heaptrix ones. In every round:
+//   1. nearest neighbours are determined for clusters whose rows changed,
+//   2. RNN pairs are collected and given identifiers of new clusters,
+//   3. rows of new clusters are built from rows of merged ones,
+//   4. rows of their neighbours are updated.
+// Steps 1, 3, and 4 work on disjoint rows, so they are performed in parallel.
+//
+// Rows are vectors sorted by identifiers. Identifiers of new clusters are larger than all
+// existing ones, thus they are always appended at the end of rows.
+// *******************************************************************************************
+namespace linkage_algorithm_rnn
+{
+	const double MISSING = std::numeric_limits<double>::max();
+
+	// Lance-Williams update for the complete linkage (absent edge is infinite).
+	struct complete_rule {
+		static constexpr bool never_decreases = true;
+
+		double operator()(double d_ik, int n_i, double d_jk, int n_j) const {
+			return std::max(d_ik, d_jk);
+		}
+	};
+
+	// UPGMA (absent edge stays absent as in complete linkage).
+	struct average_rule {
+		static constexpr bool never_decreases = false;
+
+		double operator()(double d_ik, int n_i, double d_jk, int n_j) const {
+			return (d_ik == MISSING || d_jk == MISSING) ? MISSING : (d_ik * n_i + d_jk * n_j) / (n_i + n_j);
+		}
+	};
+
+	// WPGMA (absent edge stays absent as in complete linkage).
+	struct weighted_rule {
+		static constexpr bool never_decreases = false;
+
+		double operator()(double d_ik, int n_i, double d_jk, int n_j) const {
+			return (d_ik == MISSING || d_jk == MISSING) ? MISSING : (d_ik + d_jk) / 2;
+		}
+	};
+
+	// *******************************************************************************************
+	// Threads which are started once and execute subsequent jobs together with the caller
+	// (RNN performs a few parallel steps in every round, so threads are not created per step).
+	class worker_pool {
+		std::vector<std::thread> workers;
+		std::mutex mtx;
+		std::condition_variable cv_start;
+		std::condition_variable cv_done;
+
+		const std::function<void()>* job{ nullptr };
+		uint64_t generation{ 0 };
+		int n_busy{ 0 };
+		bool finished{ false };
+
+	public:
+		worker_pool(int n_workers) {
+			workers.reserve(n_workers);
+			for (int i = 0; i < n_workers; ++i) {
+				workers.emplace_back([this]() {
+					uint64_t seen = 0;
+					while (true) {
+						const std::function<void()>* f;
+						{
+							std::unique_lock<std::mutex> lck(mtx);
+							cv_start.wait(lck, [this, seen]() { return finished || generation != seen; });
+							if (finished) {
+								return;
+							}
+							seen = generation;
+							f = job;
+						}
+
+						(*f)();
+
+						std::lock_guard<std::mutex> lck(mtx);
+						if (--n_busy == 0) {
+							cv_done.notify_one();
+						}
+					}
+				});
+			}
+		}
+
+		~worker_pool() {
+			{
+				std::lock_guard<std::mutex> lck(mtx);
+				finished = true;
+			}
+			cv_start.notify_all();
+			for (auto& w : workers) {
+				w.join();
+			}
+		}
+
+		// Runs f on all workers and the calling thread, returns when all of them finish.
+		void run(const std::function<void()>& f) {
+			{
+				std::lock_guard<std::mutex> lck(mtx);
+				job = &f;
+				n_busy = (int)workers.size();
+				++generation;
+			}
+			cv_start.notify_all();
+
+			f();
+
+			std::unique_lock<std::mutex> lck(mtx);
+			cv_done.wait(lck, [this]() { return n_busy == 0; });
+			job = nullptr;
+		}
+	};
+
+	template <class Distance, class Rule>
+	class linkage : public HierarchicalClustering<Distance> {
+
+		struct entry_t {
+			int id;
+			double d;
+
+			bool operator<(const entry_t& rhs) const { return id < rhs.id; }
+		};
+
+		struct merge_t {
+			int first;
+			int second;
+			double d;
+		};
+
+		int numThreads;
+		Rule rule;
+
+		// merges above this value are not needed (dendrogram is cut below it)
+		double stop_threshold{ std::numeric_limits<double>::infinity() };
+
+		int n_objects{ 0 };
+		std::vector<std::vector<entry_t>> rows;
+		std::vector<int> sizes;
+		std::vector<int> rep;			// cluster to which object / cluster was merged in the current round
+		std::vector<int> nn;			// nearest neighbour (-1 for empty rows)
+		std::vector<double> nn_d;
+		std::vector<merge_t> merges;	// merge k creates cluster n_objects + k
+
+		std::unique_ptr<worker_pool> pool;	// exists only while a dendrogram is built
+
+		// *******************************************************************************************
+		// Invokes f(i) for i in [0, n) - in parallel only if there is enough work.
+		template <class F>
+		void parallel_for(size_t n, F f) {
+			const size_t MIN_PARALLEL = 4096;
+			const size_t CHUNK_SIZE = 256;
+
+			if (!pool || n < MIN_PARALLEL) {
+				for (size_t i = 0; i < n; ++i) {
+					f(i);
+				}
+				return;
+			}
+
+			std::atomic<size_t> next{ 0 };
+			pool->run([&next, n, &f, CHUNK_SIZE]() {
+				size_t first;
+				while ((first = next.fetch_add(CHUNK_SIZE)) < n) {
+					size_t last = std::min(first + CHUNK_SIZE, n);
+					for (size_t i = first; i < last; ++i) {
+						f(i);
+					}
+				}
+			});
+		}
+
+		// *******************************************************************************************
+		void read_matrix(SparseMatrix<Distance>& m, int nObjects) {
+			n_objects = nObjects;
+
+			rows.clear();
+			rows.resize(2 * (size_t)n_objects);
+			sizes.assign(2 * (size_t)n_objects, 1);
+			rep.resize(2 * (size_t)n_objects);
+			std::iota(rep.begin(), rep.end(), 0);
+			nn.assign(2 * (size_t)n_objects, -1);
+			nn_d.assign(2 * (size_t)n_objects, MISSING);
+			merges.clear();
+			merges.reserve(n_objects);
+
+			// input segments are released as soon as all their rows are copied 
+			// (rows of a half matrix are needed by other rows through the reverse index)
+			int n_rows = std::min((int)m.num_objects(), n_objects);
+			typename SparseMatrix<Distance>::segment_releaser releaser(m);
+			for (int i = n_rows; i < (int)m.num_objects() && !m.half_matrix; ++i) {
+				releaser.done(i);
+			}
+
+			parallel_for(n_rows, [this, &m, &releaser](size_t i) {
+				auto& row = rows[i];
+				row.reserve(m.num_neighbours((int)i));
+				for (const Distance edge : m.neighbours((int)i)) {
+					double d = edge.get_d();
+					if (d != MISSING && d != std::numeric_limits<double>::infinity() && edge.get_id() != i && !is_pruned(d)) {
+						row.push_back(entry_t{ (int)edge.get_id(), d });
+					}
+				}
+				std::sort(row.begin(), row.end());
+				if (!m.half_matrix) {
+					releaser.done((int)i);
+				}
+			});
+
+			m.clear_rows();
+		}
+
+		// *******************************************************************************************
+		// For rules which never decrease (complete linkage), a value above the stop threshold 
+		// cannot take part in any needed merge, so it can be treated as absent.
+		bool is_pruned(double d) const { return Rule::never_decreases && d > stop_threshold; }
+
+		// *******************************************************************************************
+		// Nearest neighbour with ties resolved by smaller identifiers (not the heaptrix order).
+		void find_nn(int c) {
+			nn[c] = -1;
+			nn_d[c] = MISSING;
+			for (const auto& e : rows[c]) {
+				if (e.d < nn_d[c]) {
+					nn[c] = e.id;
+					nn_d[c] = e.d;
+				}
+			}
+		}
+
+		// *******************************************************************************************
+		// Builds row of cluster m from rows of its children. Distances to other new clusters
+		// are calculated only for those of larger identifiers (mirrored afterwards), so that
+		// both directions are identical.
+		void merge_rows(int m) {
+			const merge_t& mg = merges[m - n_objects];
+			const auto& ri = rows[mg.first];
+			const auto& rj = rows[mg.second];
+			int n_i = sizes[mg.first];
+			int n_j = sizes[mg.second];
+
+			auto& out = rows[m];
+			std::vector<entry_t> via;	// (cluster, distance) for clusters merged in this round
+
+			auto add = [&](int c, double d_i, double d_j) {
+				if (c == mg.first || c == mg.second) {
+					return;
+				}
+				double d = rule(d_i, n_i, d_j, n_j);
+				if (d == MISSING || is_pruned(d)) {
+					return;
+				}
+				if (rep[c] == c) {
+					out.push_back(entry_t{ c, d });
+				}
+				else if (rep[c] > m) {
+					via.push_back(entry_t{ c, d });
+				}
+			};
+
+			auto pi = ri.begin(), pj = rj.begin();
+			while (pi != ri.end() || pj != rj.end()) {
+				if (pj == rj.end() || (pi != ri.end() && pi->id < pj->id)) {
+					add(pi->id, pi->d, MISSING);
+					++pi;
+				}
+				else if (pi == ri.end() || pj->id < pi->id) {
+					add(pj->id, MISSING, pj->d);
+					++pj;
+				}
+				else {
+					add(pi->id, pi->d, pj->d);
+					++pi;
+					++pj;
+				}
+			}
+
+			// combine distances to both children of every other new cluster
+			std::sort(via.begin(), via.end(), [this](const entry_t& a, const entry_t& b) {
+				return (rep[a.id] == rep[b.id]) ? a.id < b.id : rep[a.id] < rep[b.id];
+			});
+
+			for (size_t k = 0; k < via.size(); ) {
+				int target = rep[via[k].id];
+				const merge_t& other = merges[target - n_objects];
+
+				double d_first = MISSING, d_second = MISSING;
+				for (; k < via.size() && rep[via[k].id] == target; ++k) {
+					(via[k].id == other.first ? d_first : d_second) = via[k].d;
+				}
+
+				double d = rule(d_first, sizes[other.first], d_second, sizes[other.second]);
+				if (d != MISSING && !is_pruned(d)) {
+					out.push_back(entry_t{ target, d });
+				}
+			}
+		}
+
+		// *******************************************************************************************
+		// Replaces entries of merged clusters in the row of not merged cluster k.
+		void update_row(int k) {
+			auto& row = rows[k];
+			std::vector<int> targets;
+
+			size_t w = 0;
+			for (const auto& e : row) {
+				if (rep[e.id] == e.id) {
+					row[w++] = e;
+				}
+				else {
+					targets.push_back(rep[e.id]);
+				}
+			}
+			row.resize(w);
+
+			std::sort(targets.begin(), targets.end());
+			targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+			for (int m : targets) {
+				const auto& rm = rows[m];
+				auto it = std::lower_bound(rm.begin(), rm.end(), entry_t{ k, 0 });
+				if (it != rm.end() && it->id == k) {
+					row.push_back(entry_t{ m, it->d });
+				}
+			}
+		}
+
+		// *******************************************************************************************
+		void do_clustering() {
+
+			int next_id = n_objects;
+			std::vector<int> dirty;
+			std::vector<int> dirty_round(2 * (size_t)n_objects, -1);
+			std::vector<std::pair<int, int>> pairs;
+			std::vector<int> neighbours;
+
+			for (int i = 0; i < n_objects; ++i) {
+				if (!rows[i].empty()) {
+					dirty.push_back(i);
+				}
+			}
+
+			int n_rounds = 0;
+			for (int round = 0; !dirty.empty(); ++round) {
+				++n_rounds;
+
+				// nearest neighbours of changed clusters
+				parallel_for(dirty.size(), [this, &dirty](size_t k) { find_nn(dirty[k]); });
+				for (int c : dirty) {
+					dirty_round[c] = round;
+				}
+
+				// reciprocal pairs (any new pair contains a cluster with recalculated neighbour);
+				// merges are monotonic - pairs above the cut would be merged after all needed ones
+				pairs.clear();
+				for (int c : dirty) {
+					int other = nn[c];
+					if (other >= 0 && nn[other] == c && (c < other || dirty_round[other] != round) && nn_d[c] <= stop_threshold) {
+						pairs.emplace_back(std::min(c, other), std::max(c, other));
+					}
+				}
+
+				if (pairs.empty()) {
+					break;
+				}
+
+				std::sort(pairs.begin(), pairs.end(), [this](const auto& a, const auto& b) {
+					return (nn_d[a.first] == nn_d[b.first]) ? a < b : nn_d[a.first] < nn_d[b.first];
+				});
+
+				int first_new = next_id;
+				for (const auto& p : pairs) {
+					merges.push_back(merge_t{ p.first, p.second, nn_d[p.first] });
+					sizes[next_id] = sizes[p.first] + sizes[p.second];
+					rep[p.first] = rep[p.second] = next_id;
+					++next_id;
+				}
+
+				// rows of new clusters
+				parallel_for(pairs.size(), [this, first_new](size_t k) { merge_rows(first_new + (int)k); });
+
+				for (int m = first_new; m < next_id; ++m) {
+					auto& row = rows[m];
+					for (auto it = row.rbegin(); it != row.rend() && it->id >= first_new; ++it) {
+						rows[it->id].push_back(entry_t{ m, it->d });
+					}
+				}
+
+				parallel_for(pairs.size(), [this, first_new](size_t k) {
+					auto& row = rows[first_new + k];
+					auto it = std::partition_point(row.begin(), row.end(), [first_new](const entry_t& e) { return e.id < first_new; });
+					std::sort(it, row.end());
+				});
+
+				// rows of neighbours of merged clusters
+				neighbours.clear();
+				for (const auto& p : pairs) {
+					for (int c : { p.first, p.second }) {
+						for (const auto& e : rows[c]) {
+							if (rep[e.id] == e.id) {
+								neighbours.push_back(e.id);
+							}
+						}
+					}
+				}
+				std::sort(neighbours.begin(), neighbours.end());
+				neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+				parallel_for(neighbours.size(), [this, &neighbours](size_t k) { update_row(neighbours[k]); });
+
+				// merged clusters are removed
+				for (const auto& p : pairs) {
+					std::vector<entry_t>().swap(rows[p.first]);
+					std::vector<entry_t>().swap(rows[p.second]);
+					nn[p.first] = nn[p.second] = -1;
+				}
+
+				// clusters with changed rows have to recalculate neighbours
+				dirty.swap(neighbours);
+				for (int m = first_new; m < next_id; ++m) {
+					dirty.push_back(m);
+				}
+			}
+
+			LOG_VERBOSE << "(" << merges.size() << " merges in " << n_rounds << " rounds) ";
+			std::vector<std::vector<entry_t>>().swap(rows);
+		}
+
+		// *******************************************************************************************
+		// Orders merges by distances (keeping children before parents) and renumbers clusters
+		// accordingly, so that the result has the same form as the heaptrix one.
+		std::vector<node_t> makeDendrogram() {
+			int n_merges = (int)merges.size();
+
+			std::vector<double> keys(n_merges);
+			for (int k = 0; k < n_merges; ++k) {
+				keys[k] = merges[k].d;
+				for (int c : { merges[k].first, merges[k].second }) {
+					if (c >= n_objects) {
+						keys[k] = std::max(keys[k], keys[c - n_objects]);
+					}
+				}
+			}
+
+			std::vector<int> order(n_merges);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+
+			std::vector<int> labels(n_merges);
+			for (int p = 0; p < n_merges; ++p) {
+				labels[order[p]] = n_objects + p;
+			}
+
+			auto label = [this, &labels](int c) { return c < n_objects ? c : labels[c - n_objects]; };
+
+			std::vector<node_t> dendrogram(n_objects);
+			dendrogram.reserve(n_objects + n_merges);
+
+			for (int p = 0; p < n_merges; ++p) {
+				const merge_t& mg = merges[order[p]];
+				int a = label(mg.first);
+				int b = label(mg.second);
+				dendrogram.emplace_back(std::min(a, b), std::max(a, b), mg.d);
+			}
+
+			return dendrogram;
+		}
+
+		// *******************************************************************************************
+		std::vector<node_t> build(SparseMatrix<Distance>& matrix, int nObjects) {
+			ksi::clock stopwatch;
+
+			// the calling thread is one of the workers
+			if (numThreads > 1) {
+				pool = std::make_unique<worker_pool>(numThreads - 1);
+			}
+
+			LOG_VERBOSE << "Loading data into rows ";
+			stopwatch.start();
+			read_matrix(matrix, nObjects);
+			stopwatch.stop();
+			LOG_VERBOSE << "done in " << (double)stopwatch.elapsed_milliseconds() / 1000 << " s. ";
+
+			LOG_VERBOSE << "Performing linkage ";
+			stopwatch.start();
+			do_clustering();
+			stopwatch.stop();
+			LOG_VERBOSE << "done in " << (double)stopwatch.elapsed_milliseconds() / 1000 << " s. ";
+
+			pool.reset();
+
+			return makeDendrogram();
+		}
+
+	public:
+		linkage(int numThreads) : numThreads(std::max(numThreads, 1)) {}
+
+		int operator()(
+			SparseMatrix<Distance>& matrix,
+			const std::vector<int>& objects,
+			double threshold,
+			std::vector<int>& assignments) override {
+
+			stop_threshold = this->keepDendrogram ? std::numeric_limits<double>::infinity() : threshold;
+			std::vector<node_t> dendrogram = build(matrix, (int)objects.size());
+			assignments.resize(objects.size());
+			int n_clusters = this->dendrogramToAssignments(dendrogram, threshold, assignments);
+
+			if (this->keepDendrogram) {
+				this->lastDendrogram = std::move(dendrogram);
+			}
+
+			return n_clusters;
+		}
+
+		// Dendrogram does not depend on the threshold - build it once and cut at all thresholds.
+		std::vector<int> clusterThresholds(
+			SparseMatrix<Distance>& matrix,
+			const std::vector<int>& objects,
+			const std::vector<double>& thresholds,
+			std::vector<std::vector<int>>& assignments) override {
+
+			stop_threshold = (thresholds.empty() || this->keepDendrogram) ? 
+				std::numeric_limits<double>::infinity() : *std::max_element(thresholds.begin(), thresholds.end());
+			std::vector<node_t> dendrogram = build(matrix, (int)objects.size());
+
+			std::vector<int> n_clusters(thresholds.size());
+			assignments.assign(thresholds.size(), std::vector<int>(objects.size()));
+
+			for (size_t i = 0; i < thresholds.size(); ++i) {
+				n_clusters[i] = this->dendrogramToAssignments(dendrogram, thresholds[i], assignments[i]);
+			}
+
+			if (this->keepDendrogram) {
+				this->lastDendrogram = std::move(dendrogram);
+			}
+
+			return n_clusters;
+		}
+	};
+}
+
+
+template <class Distance>
+class CompleteLinkageRNN : public linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::complete_rule>
+{
+public:
+	CompleteLinkageRNN(int numThreads)
+		: linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::complete_rule>(numThreads) {}
+};
+
+template <class Distance>
+class AverageLinkageRNN : public linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::average_rule>
+{
+public:
+	AverageLinkageRNN(int numThreads)
+		: linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::average_rule>(numThreads) {}
+};
+
+template <class Distance>
+class WeightedLinkageRNN : public linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::weighted_rule>
+{
+public:
+	WeightedLinkageRNN(int numThreads)
+		: linkage_algorithm_rnn::linkage<Distance, linkage_algorithm_rnn::weighted_rule>(numThreads) {}
+};
@@ -22,7 +22,7 @@ int main(int argc, char** argv)
 
 		std::vector<int> objects;
 		std::vector<string_view> names;
-		std::vector<int> assignments;
+		std::vector<std::vector<int>> assignments;
 
 		if (!console.init(argc, argv, params)) {
 			return 0;
@@ -31,9 +31,10 @@ int main(int argc, char** argv)
 		std::unique_ptr<Graph> graph = console.loadGraph(params);
 
 		console.loadObjects(params, *graph, objects, names);
-		if (graph->getNumEdges() > 0) {
+		if (graph->getNumEdges() > 0 || !params.dendrogramInput.empty()) {
 			console.doClustering(params, *graph, objects, assignments);
 		}
+		console.saveDendrogram(params, *graph, names);
 		console.saveAssignments(params, *graph, names, assignments);
 
    }
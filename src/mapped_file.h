@@ -0,0 +1,127 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// *******************************************************************************************
+// Read-only file mapped privately (copy-on-write) into the address space, so that parsers
+// are allowed to modify the contents (e.g., by putting terminating zeros) without affecting
+// the file. The mapping is followed by a zero page, thus a byte right after the last one
+// is always addressable (parsers dereference block_end).
+//
+// Lifetime: the mapping lives as long as the object. Parts of the mapping which are not
+// referenced anymore can be given back to the OS with release().
+// *******************************************************************************************
+class MappedFile {
+
+	char* base{ nullptr };
+	size_t fileSize{ 0 };
+	size_t reservedSize{ 0 };
+	size_t pageSize{ 4096 };
+
+public:
+#ifdef _WIN32
+	static constexpr bool SUPPORTED = false;
+#else
+	static constexpr bool SUPPORTED = true;
+#endif
+
+	MappedFile() {}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() { close(); }
+
+	char* data() const { return base; }
+	size_t size() const { return fileSize; }
+
+	// *******************************************************************************************
+	bool open(const std::string& fileName) {
+#ifdef _WIN32
+		return false;
+#else
+		close();
+
+		int fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			::close(fd);
+			return false;
+		}
+
+		fileSize = (size_t)st.st_size;
+		pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		reservedSize = alignUp(fileSize) + pageSize;
+
+		// reserve anonymous (zeroed) region and map the file over its beginning
+		void* region = mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region == MAP_FAILED) {
+			::close(fd);
+			return false;
+		}
+
+		if (fileSize > 0 &&
+			mmap(region, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(region, reservedSize);
+			::close(fd);
+			return false;
+		}
+
+		::close(fd);
+		base = (char*)region;
+		madvise(base, reservedSize, MADV_SEQUENTIAL);
+
+		return true;
+#endif
+	}
+
+	// *******************************************************************************************
+	void close() {
+#ifndef _WIN32
+		if (base) {
+			munmap(base, reservedSize);
+		}
+#endif
+		base = nullptr;
+		fileSize = 0;
+		reservedSize = 0;
+	}
+
+	// *******************************************************************************************
+	// Gives back pages entirely contained in [begin, end) range. Pages shared with neighbouring
+	// ranges are kept until the file is closed.
+	void release(const char* begin, const char* end) {
+#ifndef _WIN32
+		char* first = base + alignUp(begin - base);
+		char* last = base + alignDown(end - base);
+		if (first < last) {
+			madvise(first, last - first, MADV_DONTNEED);
+		}
+#endif
+	}
+
+private:
+	size_t alignUp(size_t v) const { return (v + pageSize - 1) / pageSize * pageSize; }
+	size_t alignDown(size_t v) const { return v / pageSize * pageSize; }
+};
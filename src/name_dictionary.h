@@ -0,0 +1,153 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include "hasher.h"
+#include "chunked_vector.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+
+
+/*********************************************************************************************************************/
+// Name of an object with its numerical identifier (-1 if not assigned yet).
+struct NameEntry {
+	std::string_view name;
+	int id{ -1 };
+};
+
+/*********************************************************************************************************************/
+// Dictionary of object names shared by the parser threads. Names are distributed over shards by
+// the highest bits of their hashes; every shard is an open addressing table with linear probing
+// protected by its own mutex. Entries have stable addresses, so parsers resolve names to entries
+// and the identifiers may be assigned later by a single thread in a deterministic order.
+class NameDictionary {
+
+	static constexpr int SHARD_BITS = 6;
+	static constexpr int NUM_SHARDS = 1 << SHARD_BITS;
+	static constexpr size_t INITIAL_SLOTS = 1024;
+
+	struct Slot {
+		uint64_t hash{ 0 };
+		NameEntry* entry{ nullptr };
+	};
+
+	struct alignas(64) Shard {
+		mutable std::mutex mtx;
+		std::vector<Slot> slots;
+		std::deque<NameEntry> entries;
+		chunked_vector<char> names{ 1LL << 20 }; // 1MB chunk size
+
+		Shard() : slots(INITIAL_SLOTS) {}
+
+		// returns slot with a given name or an empty slot where it should be placed
+		Slot& locate(std::string_view name, uint64_t hash) {
+			size_t mask = slots.size() - 1;
+			for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+				Slot& s = slots[i];
+				if (s.entry == nullptr || (s.hash == hash && s.entry->name == name)) {
+					return s;
+				}
+			}
+		}
+
+		// keeps load factor at most 0.5
+		void rehash(size_t n_slots) {
+			std::vector<Slot> old(n_slots);
+			std::swap(old, slots);
+			for (const Slot& s : old) {
+				if (s.entry) {
+					locate(s.entry->name, s.hash) = s;
+				}
+			}
+		}
+	};
+
+	std::unique_ptr<Shard[]> shards{ new Shard[NUM_SHARDS] };
+
+	WyHash64<std::string_view> hasher;
+
+	Shard& shard(uint64_t hash) const { return shards[hash >> (64 - SHARD_BITS)]; }
+
+public:
+
+	uint64_t hash(std::string_view name) const { return hasher(name); }
+
+	// Returns entry of a name inserting it if necessary. When copyName is set, a name is stored
+	// in the dictionary memory, otherwise a view must remain valid as long as the dictionary.
+	// Can be invoked concurrently.
+	NameEntry* insert(std::string_view name, uint64_t hash, bool copyName = true) {
+		Shard& sh = shard(hash);
+		std::lock_guard<std::mutex> lck(sh.mtx);
+
+		Slot& s = sh.locate(name, hash);
+		if (s.entry) {
+			return s.entry;
+		}
+
+		if (copyName) {
+			char* dst = sh.names.resize_for_additional(name.size() + 1);
+			std::copy_n(name.data(), name.size(), dst); // 0 is already there
+			name = std::string_view(dst, name.size());
+		}
+
+		sh.entries.push_back(NameEntry{ name, -1 });
+		s = Slot{ hash, &sh.entries.back() };
+
+		if (sh.entries.size() * 2 > sh.slots.size()) {
+			sh.rehash(sh.slots.size() * 2);
+		}
+
+		return &sh.entries.back();
+	}
+
+	NameEntry* insert(std::string_view name, bool copyName = true) { return insert(name, hash(name), copyName); }
+
+	// Returns entry of a name or nullptr if absent.
+	const NameEntry* find(std::string_view name) const {
+		uint64_t h = hash(name);
+		Shard& sh = shard(h);
+		std::lock_guard<std::mutex> lck(sh.mtx);
+
+		return sh.locate(name, h).entry;
+	}
+
+	size_t size() const {
+		size_t n = 0;
+		for (int i = 0; i < NUM_SHARDS; ++i) {
+			std::lock_guard<std::mutex> lck(shards[i].mtx);
+			n += shards[i].entries.size();
+		}
+		return n;
+	}
+
+	// Reserves space for a given total number of names (not thread-safe).
+	void reserve(size_t n_names) {
+		size_t per_shard = n_names / NUM_SHARDS + 1;
+		for (int i = 0; i < NUM_SHARDS; ++i) {
+			size_t n_slots = shards[i].slots.size();
+			while (n_slots < 2 * per_shard) {
+				n_slots *= 2;
+			}
+			if (n_slots > shards[i].slots.size()) {
+				shards[i].rehash(n_slots);
+			}
+		}
+	}
+
+	// Removes all names (not thread-safe).
+	void clear() {
+		shards.reset(new Shard[NUM_SHARDS]);
+	}
+};
@@ -8,6 +8,9 @@
 //uncomment for queue monitoring
 //#define REFRESH_PROFILE_QUEUES
 
+//uncomment to use queues based on mutexes in loading pipelines (required for monitoring)
+//#define REFRESH_LOCKING_QUEUES
+
 namespace refresh {
 	class IQueueObserver {
 	public:
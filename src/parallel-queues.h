@@ -7,6 +7,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <map>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 namespace refresh {
 
@@ -440,5 +443,321 @@ namespace refresh {
 		}
 	};
 
+	//waiting support for lock-free queues: the fast path does not touch the epoch, 
+	//threads which have to wait sleep on it (atomic wait) after a short spinning
+	class waiting_room
+	{
+		std::atomic<uint32_t> epoch{ 0 };
+		std::atomic<uint32_t> n_waiting{ 0 };
+
+	public:
+		//waits until the condition is true
+		template<typename PRED>
+		void wait_until(PRED pred)
+		{
+			for (int i = 0; i < 64; ++i)
+			{
+				if (pred())
+					return;
+				std::this_thread::yield();
+			}
+
+			while (true)
+			{
+				n_waiting.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				auto e = epoch.load();
+				if (pred())
+				{
+					n_waiting.fetch_sub(1);
+					return;
+				}
+				epoch.wait(e);
+				n_waiting.fetch_sub(1);
+			}
+		}
+
+		void notify()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (n_waiting.load() > 0)
+			{
+				epoch.fetch_add(1);
+				epoch.notify_all();
+			}
+		}
+	};
+
+	//implements bounded lock-free MPMC queue (ring of cells with sequence numbers), 
+	//the interface is the same as of parallel_queue
+	//queue observers are not supported as they are not thread-safe
+	template<typename T>
+	class lockfree_parallel_queue
+	{
+		//seq == 2 * pos - the cell awaits push at pos, seq == 2 * pos + 1 - the cell contains element pos
+		struct cell_t
+		{
+			std::atomic<size_t> seq;
+			T data;
+		};
+
+		std::unique_ptr<cell_t[]> cells;
+		size_t capacity;
+
+		alignas(64) std::atomic<size_t> push_pos{ 0 };
+		alignas(64) std::atomic<size_t> pop_pos{ 0 };
+
+		alignas(64) std::atomic<size_t> n_writers;
+		std::atomic<bool> is_completed{ false };
+		std::atomic<bool> canceled{ false };
+		std::string name;
+
+		waiting_room push_room;
+		waiting_room pop_room;
+
+		bool try_push(T& elem)
+		{
+			size_t pos = push_pos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell_t& cell = cells[pos % capacity];
+				size_t seq = cell.seq.load(std::memory_order_acquire);
+
+				if (seq == 2 * pos)
+				{
+					if (push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						cell.data = std::move(elem);
+						cell.seq.store(2 * pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (seq < 2 * pos)
+					return false; //full
+				else
+					pos = push_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		bool try_pop(T& elem)
+		{
+			size_t pos = pop_pos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell_t& cell = cells[pos % capacity];
+				size_t seq = cell.seq.load(std::memory_order_acquire);
+
+				if (seq == 2 * pos + 1)
+				{
+					if (pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						elem = std::move(cell.data);
+						cell.seq.store(2 * (pos + capacity), std::memory_order_release);
+						return true;
+					}
+				}
+				else if (seq < 2 * pos + 1)
+					return false; //empty
+				else
+					pos = pop_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+	public:
+		lockfree_parallel_queue(
+			size_t size,
+			size_t n_writers = 1,
+			const std::string& name = "",
+			IQueueObserver* /*queue_observer*/ = nullptr)
+			:
+			cells(new cell_t[size]),
+			capacity(size),
+			n_writers(n_writers),
+			name(name)
+		{
+			for (size_t i = 0; i < capacity; ++i)
+				cells[i].seq.store(2 * i, std::memory_order_relaxed);
+		}
+
+		//returns false if pushing thread should stop
+		bool push_or_cancel(T&& elem)
+		{
+			bool pushed = false;
+			push_room.wait_until([this, &elem, &pushed] {
+				return canceled.load() || (pushed = try_push(elem));
+				});
+
+			if (!pushed)
+				return false;
+
+			pop_room.notify();
+			return true;
+		}
+
+		void push(T&& elem)
+		{
+			push_room.wait_until([this, &elem] { return try_push(elem); });
+			pop_room.notify();
+		}
+
+		bool pop(T& elem)
+		{
+			bool popped = false;
+			pop_room.wait_until([this, &elem, &popped] {
+				if ((popped = try_pop(elem)))
+					return true;
+				//all pushes precede completion, so the queue has to be checked once more
+				return is_completed.load() && !(popped = try_pop(elem));
+				});
+
+			if (popped)
+				push_room.notify();
+
+			return popped;
+		}
+
+		void mark_completed()
+		{
+			if (n_writers.fetch_sub(1) == 1)
+			{
+				is_completed.store(true);
+				pop_room.notify();
+			}
+		}
+
+		bool check_completed() {
+			return is_completed.load();
+		}
+
+		void cancel()
+		{
+			canceled.store(true);
+			push_room.notify();
+		}
+	};
+
+	//implements lock-free priority queue for consecutive priorities starting from 0 - a reorder buffer 
+	//with elements put at priority modulo capacity, the interface is the same as of parallel_priority_queue
+	//queue observers are not supported as they are not thread-safe
+	template<typename T>
+	class lockfree_parallel_priority_queue
+	{
+		//seq == 2 * p - the slot awaits priority p, seq == 2 * p + 1 - the slot contains priority p
+		struct slot_t
+		{
+			std::atomic<uint64_t> seq;
+			T data;
+		};
+
+		std::unique_ptr<slot_t[]> slots;
+		size_t capacity;
+
+		alignas(64) std::atomic<uint64_t> current_priority{ 0 };
+
+		alignas(64) std::atomic<uint64_t> n_writers;
+		std::atomic<bool> is_completed{ false };
+		std::string name;
+
+		waiting_room push_room;
+		waiting_room pop_room;
+
+		bool try_pop(T& elem, uint64_t& priority)
+		{
+			uint64_t p = current_priority.load(std::memory_order_relaxed);
+			while (true)
+			{
+				slot_t& slot = slots[p % capacity];
+				uint64_t seq = slot.seq.load(std::memory_order_acquire);
+
+				if (seq == 2 * p + 1)
+				{
+					if (current_priority.compare_exchange_weak(p, p + 1, std::memory_order_relaxed))
+					{
+						elem = std::move(slot.data);
+						priority = p;
+						slot.seq.store(2 * (p + capacity), std::memory_order_release);
+						return true;
+					}
+				}
+				else if (seq < 2 * p + 1)
+					return false; //next priority not present
+				else
+					p = current_priority.load(std::memory_order_relaxed);
+			}
+		}
+
+	public:
+		lockfree_parallel_priority_queue(
+			size_t size,
+			uint64_t n_writers = 1,
+			const std::string& name = "",
+			IQueueObserver* /*queue_observer*/ = nullptr) :
+			slots(new slot_t[size]),
+			capacity(size),
+			n_writers(n_writers),
+			name(name)
+		{
+			for (size_t i = 0; i < capacity; ++i)
+				slots[i].seq.store(2 * i, std::memory_order_relaxed);
+		}
+
+		void push(uint64_t priority, T&& elem)
+		{
+			//wait until the element capacity positions earlier is popped
+			slot_t& slot = slots[priority % capacity];
+			push_room.wait_until([&slot, priority] { return slot.seq.load(std::memory_order_acquire) == 2 * priority; });
+
+			slot.data = std::move(elem);
+			slot.seq.store(2 * priority + 1, std::memory_order_release);
+
+			pop_room.notify();
+		}
+
+		bool pop(T& elem)
+		{
+			uint64_t priority;
+			return pop(elem, priority);
+		}
+
+		bool pop(T& elem, uint64_t& priority)
+		{
+			bool popped = false;
+			pop_room.wait_until([this, &elem, &priority, &popped] {
+				if ((popped = try_pop(elem, priority)))
+					return true;
+				return is_completed.load() && !(popped = try_pop(elem, priority));
+				});
+
+			if (popped)
+				push_room.notify();
+
+			return popped;
+		}
+
+		void mark_completed()
+		{
+			if (n_writers.fetch_sub(1) == 1)
+			{
+				is_completed.store(true);
+				pop_room.notify();
+			}
+		}
+	};
+
+	//queues of loading pipelines (define REFRESH_LOCKING_QUEUES to use ones based on mutexes)
+#ifdef REFRESH_LOCKING_QUEUES
+	template<typename T>
+	using pipeline_queue = parallel_queue<T>;
+
+	template<typename T>
+	using pipeline_priority_queue = parallel_priority_queue<T>;
+#else
+	template<typename T>
+	using pipeline_queue = lockfree_parallel_queue<T>;
+
+	template<typename T>
+	using pipeline_priority_queue = lockfree_parallel_priority_queue<T>;
+#endif
+
 } //namespace refresh
 #endif // _REFRESH_PARALLEL_QUEUES
@@ -11,6 +11,8 @@
 #include "log.h"
 #include "leiden.h"
 #include "version.h"
+#include "mapped_file.h"
+#include "random_access_file.h"
 
 #include <vector>
 #include <fstream>
@@ -20,29 +22,57 @@ using namespace std;
 
 void Params::printUsage() const {
 	LOG_NORMAL << "Usage:" << endl
-		<< "clusty [options] <distances> <assignments>" << endl << endl
+		<< "clusty [options] <distances> <assignments>" << endl
+		<< "clusty [options] " + PARAM_LOAD_GRAPH + " <graph> <assignments>" << endl
+		<< "clusty [options] " + PARAM_FROM_DENDROGRAM + " <dendrogram> <assignments>" << endl << endl
 		<< "Parameters:" << endl
 		<< "  <distances> - input TSV/CSV table with pairwise distances" << endl
 		<< "  <assignments> - output TSV/CSV table with assignments" << endl << endl
 		<< "Options:" << endl
 		<< "  " + PARAM_FILE_OBJECTS + " <string> - optional TSV/CSV file with object names in the first column sorted decreasingly w.r.t. representativness" << endl
-		<< "  " + PARAM_ALGO + " <single | complete | uclust | set-cover | cd-hit | leiden> - clustering algorithm:" << endl
+		<< "  " + PARAM_ALGO + " <single | complete | average | weighted | uclust | set-cover | cd-hit | leiden> - clustering algorithm:" << endl
 		<< "    * single     - single linkage (connected component, MMseqs mode 1)" << endl
 		<< "    * complete   - complete linkage" << endl
+		<< "    * average    - average linkage (UPGMA)" << endl
+		<< "    * weighted   - weighted average linkage (WPGMA)" << endl
 		<< "    * uclust     - UCLUST" << endl
 		<< "    * set-cover  - greedy set cover (MMseqs mode 0)" << endl
 		<< "    * cd-hit     - CD-HIT (greedy incremental; MMseqs mode 2)" << endl
 		<< "    * leiden     - Leiden algorithm" << endl << endl
 
+		<< "  " + PARAM_LINKAGE_ENGINE + " <heaptrix | rnn> - implementation of hierarchical clustering (default: heaptrix):" << endl
+		<< "    * heaptrix   - sequential merging of the closest pair with a global heap" << endl
+		<< "    * rnn        - parallel merging of reciprocal nearest neighbours in rounds (ties may be resolved differently)" << endl
+		<< "  " + PARAM_LINKAGE_HEAP + " <binary | bucket> - priority queue of heaptrix engine (default: binary):" << endl
+		<< "    * binary     - binary heap of all distances" << endl
+		<< "    * bucket     - monotone bucket queue over [0,1] interval (faster for distances spread over this range)" << endl
+
 		<< "  " + PARAM_ID_COLUMNS + " <column-name1> <column-name2> - names of columns with sequence identifiers (default: two first columns)" << endl
 		<< "  " + PARAM_DISTANCE_COLUMN + " <column-name> - name of the column with pairwise distances (or similarities; default: third column)" << endl
+		<< "  " + PARAM_DISTANCE_PRECISION + " <double | float | fixed16> - storage of distances (default: double):" << endl
+		<< "    * double     - 64-bit floating point" << endl
+		<< "    * float      - 32-bit floating point (reduces memory by a third)" << endl
+		<< "    * fixed16    - 16-bit fixed point, distances have to be in [0,1] interval (reduces memory by half)" << endl
 		<< "  " + FLAG_SIMILARITY + " - use similarity instead of distances (has to be in [0,1] interval; default: false)" << endl
 		<< "  " + FLAG_PERCENT_SIMILARITY + " - use percent similarity (has to be in [0,100] interval; default: false)" << endl
 		<< "  " + PARAM_MIN + " <column-name> <real-threshold> - accept pairwise connections with values greater or equal given threshold in a specified column" << endl
 		<< "  " + PARAM_MAX + " <column-name> <real-threshold> - accept pairwise connections with values lower or equal given threshold in a specified column" << endl
+		<< "  " + PARAM_THRESHOLDS + " <real-threshold1,real-threshold2,...> - perform clustering at several thresholds on the distance column (in the units of the column) with a single load; assignments are stored in <assignments>.<threshold> files" << endl
 		<< "  " + FLAG_NUMERIC_IDS + " - use when sequences in the distances file are represented by numbers (can be mapped to string ids by the object file)" << endl
 		<< "  " + FLAG_OUT_REPRESENTATIVES + " - output a representative object for each cluster instead of a cluster numerical identifier (default: " << std::boolalpha << outputRepresentatives << ")" << endl
 		<< "  " + FLAG_OUT_CSV + " - output a CSV table instead of a default TSV (default: " << std::boolalpha << outputCSV << ")" << endl
+		<< "  " + FLAG_MMAP + " - parse memory-mapped distances file directly without a loader thread (default: false)" << endl
+		<< "  " + FLAG_PARALLEL_READ + " - parsers read disjoint ranges of distances file in parallel without a loader thread (default: false)" << endl
+		<< "  " + FLAG_HALF_MATRIX + " - store every edge once to halve the memory (only single, leiden, and linkage algorithms with rnn engine; default: false)" << endl
+		<< "  " + FLAG_STREAMING + " - build connected components while loading without storing the graph, memory depends only on the number of objects (only single algorithm without thresholds sweep; default: false)" << endl
+		<< "  " + PARAM_SAVE_GRAPH + " <string> - store filtered graph in a binary file for subsequent runs" << endl
+		<< "  " + PARAM_LOAD_GRAPH + " <string> - load graph from a binary file instead of distances table (filtering options are ignored)" << endl
+		<< "  " + PARAM_OUT_DENDROGRAM + " <string> - store complete dendrogram in a binary file (only single, complete, average, and weighted algorithms)" << endl
+		<< "  " + PARAM_OUT_NEWICK + " <string> - store complete dendrogram in Newick format, one tree per line (only single, complete, average, and weighted algorithms)" << endl
+		<< "  " + PARAM_FROM_DENDROGRAM + " <string> - cut dendrogram from a binary file at the thresholds instead of clustering (by default all merges are applied)" << endl
+		<< "  " + PARAM_HISTOGRAM_BINS + " <integer> - number of bins of the distance histogram reported after loading in verbose mode (default: " << histogramBins << ")" << endl
+		<< "  " + PARAM_HISTOGRAM_WIDTH + " <real> - width of histogram bins starting at 0 (default: " << histogramWidth << ")" << endl
+		<< "  " + PARAM_OUT_HISTOGRAM + " <string> - store distance histogram in a TSV file (also without verbose mode)" << endl
 		<< "  " + FLAG_VERSION + " - show Clusty version"
 
 #ifndef NO_LEIDEN
@@ -74,6 +104,18 @@ Params::Status Params::parse(int argc, char** argv) {
 			algo = str2algo(tmp);
 		}
 
+		tmp.clear();
+		findOption(args, PARAM_LINKAGE_ENGINE, tmp);
+		if (tmp.length()) {
+			linkageEngine = str2engine(tmp);
+		}
+
+		tmp.clear();
+		findOption(args, PARAM_LINKAGE_HEAP, tmp);
+		if (tmp.length()) {
+			linkageHeap = str2heap(tmp);
+		}
+
 		findOption(args, PARAM_FILE_OBJECTS, objectsFile);
 
 		findOption(args, PARAM_ID_COLUMNS, idColumns.first, idColumns.second);
@@ -81,6 +123,12 @@ Params::Status Params::parse(int argc, char** argv) {
 
 		findOption(args, PARAM_DISTANCE_COLUMN, distanceColumn);
 
+		tmp.clear();
+		findOption(args, PARAM_DISTANCE_PRECISION, tmp);
+		if (tmp.length()) {
+			distancePrecision = str2precision(tmp);
+		}
+
 		bool use_similarity = findSwitch(args, FLAG_SIMILARITY);
 		bool use_percent_similarity = findSwitch(args, FLAG_PERCENT_SIMILARITY);
 
@@ -100,9 +148,105 @@ Params::Status Params::parse(int argc, char** argv) {
 			columns2filters[column].max = std::min(value, columns2filters[column].max);
 		}
 
+		string thresholdsList;
+		if (findOption(args, PARAM_THRESHOLDS, thresholdsList)) {
+			std::istringstream iss(thresholdsList);
+			string token;
+			while (std::getline(iss, token, ',')) {
+				if (token.empty() || !(std::istringstream(token) >> value)) {
+					throw std::runtime_error("Invalid threshold: " + token);
+				}
+				thresholds.push_back(token);
+			}
+		}
+
 		outputRepresentatives = findSwitch(args, FLAG_OUT_REPRESENTATIVES);
 		outputCSV = findSwitch(args, FLAG_OUT_CSV);
 
+		findOption(args, PARAM_SAVE_GRAPH, graphOutput);
+		findOption(args, PARAM_LOAD_GRAPH, graphInput);
+
+		findOption(args, PARAM_OUT_DENDROGRAM, dendrogramOutput);
+		findOption(args, PARAM_OUT_NEWICK, newickOutput);
+		findOption(args, PARAM_FROM_DENDROGRAM, dendrogramInput);
+
+		findOption(args, PARAM_HISTOGRAM_BINS, histogramBins);
+		findOption(args, PARAM_HISTOGRAM_WIDTH, histogramWidth);
+		findOption(args, PARAM_OUT_HISTOGRAM, histogramOutput);
+		if (histogramBins < 1 || !(histogramWidth > 0)) {
+			throw std::runtime_error("Histogram needs a positive number of bins and bin width");
+		}
+
+		if (!dendrogramInput.empty()) {
+			if (!graphInput.empty() || !graphOutput.empty()) {
+				LOG_NORMAL << "Warning: binary graphs cannot be used with a dendrogram input, ignoring" << endl;
+				graphInput.clear();
+				graphOutput.clear();
+			}
+		}
+		else if (needDendrogram() && !isHierarchical(algo)) {
+			LOG_NORMAL << "Warning: dendrogram not supported by " << algo2str(algo) << " algorithm, ignoring" << endl;
+			dendrogramOutput.clear();
+			newickOutput.clear();
+		}
+
+		// without objects file the order of objects is the order of their first appearance in edges
+		// loaded for the loosest threshold (objects which appear first at tighter thresholds may differ)
+		if (thresholds.size() > 1 && objectsFile.empty() && isOrderDependent(algo)) {
+			LOG_NORMAL << "Warning: " << algo2str(algo) << " algorithm depends on the order of objects which is taken from edges passing "
+				<< "the loosest threshold, results at other thresholds may differ from separate runs (use " << PARAM_FILE_OBJECTS << " to fix the order)" << endl;
+		}
+
+		// binary graph keeps only edges that passed filters applied when it was saved
+		if (!graphInput.empty() && !columns2filters.empty()) {
+			LOG_NORMAL << "Warning: " << PARAM_MIN << "/" << PARAM_MAX << " filters are not applied to a binary graph input, ignoring" << endl;
+		}
+
+		if (findSwitch(args, FLAG_PARALLEL_READ)) {
+			if (RandomAccessFile::SUPPORTED) {
+				inputMode = InputMode::Parallel;
+			}
+			else {
+				LOG_NORMAL << "Warning: parallel input not supported on this platform, using stream mode" << endl;
+			}
+		}
+
+		if (findSwitch(args, FLAG_MMAP)) {
+			if (MappedFile::SUPPORTED) {
+				inputMode = InputMode::Mapped;
+			}
+			else {
+				LOG_NORMAL << "Warning: memory-mapped input not supported on this platform, using stream mode" << endl;
+			}
+		}
+
+		if (findSwitch(args, FLAG_HALF_MATRIX)) {
+			// only algorithms that do not need complete neighbourhoods in rows
+			// (rnn engine visits the remaining neighbours through the reverse index)
+			bool rnn = linkageEngine == LinkageEngine::RNN
+				&& (algo == Algo::CompleteLinkage || algo == Algo::AverageLinkage || algo == Algo::WeightedLinkage);
+			if ((algo == Algo::SingleLinkage && !needDendrogram()) || algo == Algo::Leiden || rnn) {
+				halfMatrix = true;
+			}
+			else if (algo == Algo::SingleLinkage) {
+				LOG_NORMAL << "Warning: half matrix not supported when storing dendrogram, using full matrix" << endl;
+			}
+			else {
+				LOG_NORMAL << "Warning: half matrix not supported by " << algo2str(algo) << " algorithm, using full matrix" << endl;
+			}
+		}
+
+		if (findSwitch(args, FLAG_STREAMING)) {
+			// edges are discarded, so neither other thresholds nor storing the graph is possible
+			if (algo == Algo::SingleLinkage && thresholds.empty() && graphInput.empty() && graphOutput.empty() 
+				&& dendrogramInput.empty() && !needDendrogram()) {
+				streaming = true;
+			}
+			else {
+				LOG_NORMAL << "Warning: streaming mode requires single algorithm without thresholds sweep, binary graphs, and dendrograms, ignoring" << endl;
+			}
+		}
+
 		// leiden parameters
 		findOption(args, PARAM_LEIDEN_RESOLUTION, leidenParams.resolution);
 		findOption(args, PARAM_LEIDEN_BETA, leidenParams.beta);
@@ -112,11 +256,15 @@ Params::Status Params::parse(int argc, char** argv) {
 
 		findOption(args, PARAM_NUM_THREADS, numThreads);
 
-		if (args.size() == 2) {
+		if (args.size() == 2 && graphInput.empty() && dendrogramInput.empty()) {
 			distancesFile = args[0];
 			output = args[1];
 			return Status::Correct;
 		}
+		else if (args.size() == 1 && (!graphInput.empty() || !dendrogramInput.empty())) {
+			output = args[0];
+			return Status::Correct;
+		}
 	}
 
 	return Status::Incorrect;
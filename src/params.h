@@ -17,6 +17,8 @@
 enum class Algo {
 	SingleLinkage,
 	CompleteLinkage,
+	AverageLinkage,
+	WeightedLinkage,
 	UClust,
 	SetCover,
 	CdHit,
@@ -30,23 +32,59 @@ enum class DistanceSpecification {
 };
 
 
+enum class DistancePrecision {
+	Double,
+	Float,
+	Fixed16
+};
+
+enum class LinkageEngine {
+	Heaptrix,
+	RNN
+};
+
+enum class LinkageHeap {
+	Binary,
+	Bucket
+};
+
 class Params {
 	const std::string PARAM_ALGO{ "--algo" };
+	const std::string PARAM_LINKAGE_ENGINE{ "--linkage-engine" };
+	const std::string PARAM_LINKAGE_HEAP{ "--linkage-heap" };
 
 	const std::string PARAM_FILE_OBJECTS{ "--objects-file" };
 
 	const std::string PARAM_ID_COLUMNS{ "--id-cols" };
 	const std::string FLAG_NUMERIC_IDS{ "--numeric-ids" };
+	const std::string PARAM_DISTANCE_PRECISION{ "--distance-precision" };
 	const std::string PARAM_DISTANCE_COLUMN{ "--distance-col" };
 	const std::string FLAG_SIMILARITY{ "--similarity" };
 	const std::string FLAG_PERCENT_SIMILARITY{ "--percent-similarity" };
 
 	const std::string PARAM_MAX{ "--max" };
 	const std::string PARAM_MIN{ "--min" };
+	const std::string PARAM_THRESHOLDS{ "--thresholds" };
 
 	const std::string FLAG_OUT_REPRESENTATIVES{ "--out-representatives" };
 	const std::string FLAG_OUT_CSV{ "--out-csv" };
 
+	const std::string PARAM_SAVE_GRAPH{ "--save-graph" };
+	const std::string PARAM_LOAD_GRAPH{ "--load-graph" };
+
+	const std::string PARAM_OUT_DENDROGRAM{ "--out-dendrogram" };
+	const std::string PARAM_OUT_NEWICK{ "--out-newick" };
+	const std::string PARAM_FROM_DENDROGRAM{ "--from-dendrogram" };
+
+	const std::string FLAG_MMAP{ "--mmap" };
+	const std::string FLAG_PARALLEL_READ{ "--parallel-read" };
+	const std::string FLAG_HALF_MATRIX{ "--half-matrix" };
+	const std::string FLAG_STREAMING{ "--streaming" };
+
+	const std::string PARAM_HISTOGRAM_BINS{ "--histogram-bins" };
+	const std::string PARAM_HISTOGRAM_WIDTH{ "--histogram-width" };
+	const std::string PARAM_OUT_HISTOGRAM{ "--out-histogram" };
+
 	const std::string PARAM_LEIDEN_RESOLUTION{ "--leiden-resolution" };
 	const std::string PARAM_LEIDEN_BETA{ "--leiden-beta" };
 	const std::string PARAM_LEIDEN_ITERATIONS{ "--leiden-iterations" };
@@ -67,6 +105,8 @@ public:
 	{
 		if (str == "single") { return Algo::SingleLinkage; }
 		else if (str == "complete") { return Algo::CompleteLinkage; }
+		else if (str == "average") { return Algo::AverageLinkage; }
+		else if (str == "weighted") { return Algo::WeightedLinkage; }
 		else if (str == "uclust") { return Algo::UClust; }
 		else if (str == "set-cover") { return Algo::SetCover; }
 		else if (str == "cd-hit") { return Algo::CdHit; }
@@ -75,10 +115,47 @@ public:
 		else { throw std::runtime_error("Unkown clustering algorithm"); }
 	}
 
+	static DistancePrecision str2precision(const std::string& str)
+	{
+		if (str == "double") { return DistancePrecision::Double; }
+		else if (str == "float") { return DistancePrecision::Float; }
+		else if (str == "fixed16") { return DistancePrecision::Fixed16; }
+
+		else { throw std::runtime_error("Unknown distance precision"); }
+	}
+
+	static LinkageEngine str2engine(const std::string& str)
+	{
+		if (str == "heaptrix") { return LinkageEngine::Heaptrix; }
+		else if (str == "rnn") { return LinkageEngine::RNN; }
+
+		else { throw std::runtime_error("Unknown linkage engine"); }
+	}
+
+	static LinkageHeap str2heap(const std::string& str)
+	{
+		if (str == "binary") { return LinkageHeap::Binary; }
+		else if (str == "bucket") { return LinkageHeap::Bucket; }
+
+		else { throw std::runtime_error("Unknown linkage heap"); }
+	}
+
+	static bool isHierarchical(Algo algo) {
+		return algo == Algo::SingleLinkage || algo == Algo::CompleteLinkage 
+			|| algo == Algo::AverageLinkage || algo == Algo::WeightedLinkage;
+	}
+
+	// algorithms whose result depends on the order of objects
+	static bool isOrderDependent(Algo algo) {
+		return algo == Algo::UClust || algo == Algo::SetCover || algo == Algo::CdHit;
+	}
+
 	static std::string algo2str(Algo algo) {
 		switch (algo) {
 		case Algo::SingleLinkage: return "single";
 		case Algo::CompleteLinkage: return "complete";
+		case Algo::AverageLinkage: return "average";
+		case Algo::WeightedLinkage: return "weighted";
 		case Algo::UClust: return "uclust";
 		case Algo::SetCover: return "set-cover";
 		case Algo::Leiden: return "leiden";
@@ -93,19 +170,35 @@ public:
 	std::string objectsFile;
 	std::string distancesFile;
 	std::string output;
+	std::string graphInput;
+	std::string graphOutput;
+	std::string dendrogramInput;
+	std::string dendrogramOutput;
+	std::string newickOutput;
+	std::string histogramOutput;
 
 	Algo algo{ Algo::SingleLinkage };
+	LinkageEngine linkageEngine{ LinkageEngine::Heaptrix };
+	LinkageHeap linkageHeap{ LinkageHeap::Binary };
 
 	std::pair<std::string, std::string> idColumns;
 	bool numericIds{ false };
 
 	std::string distanceColumn;
 	DistanceSpecification distanceSpecification{ DistanceSpecification::Distance };
+	DistancePrecision distancePrecision{ DistancePrecision::Double };
 
 	std::map<std::string, ColumnFilter> columns2filters;
+	std::vector<std::string> thresholds; // values in units of the distance column
+	InputMode inputMode{ InputMode::Stream };
+	bool halfMatrix{ false };
+	bool streaming{ false };
 	bool outputRepresentatives{ false };
 	bool outputCSV{ false };
 
+	int histogramBins{ 50 };
+	double histogramWidth{ 0.001 };
+
 	LeidenParams leidenParams;
 
 	bool verbose{ false };
@@ -115,6 +208,8 @@ public:
 	void printUsage() const;
 	Status parse(int argc, char** argv);
 
+	bool needDendrogram() const { return !dendrogramOutput.empty() || !newickOutput.empty(); }
+
 	bool findSwitch(std::vector<std::string>& params, const std::string& name) {
 		auto it = find(params.begin(), params.end(), name); // verbose mode
 		if (it != params.end()) {
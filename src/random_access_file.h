@@ -0,0 +1,104 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+// *******************************************************************************************
+// Read-only file with positional reads (pread). Unlike streams it does not have a shared
+// position, thus many threads can read disjoint parts of the file simultaneously.
+// *******************************************************************************************
+class RandomAccessFile {
+
+	int fd{ -1 };
+	size_t fileSize{ 0 };
+
+public:
+#ifdef _WIN32
+	static constexpr bool SUPPORTED = false;
+#else
+	static constexpr bool SUPPORTED = true;
+#endif
+
+	RandomAccessFile() {}
+	RandomAccessFile(const RandomAccessFile&) = delete;
+	RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+	~RandomAccessFile() { close(); }
+
+	size_t size() const { return fileSize; }
+
+	// *******************************************************************************************
+	bool open(const std::string& fileName) {
+#ifdef _WIN32
+		return false;
+#else
+		close();
+
+		fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close();
+			return false;
+		}
+
+		fileSize = (size_t)st.st_size;
+		return true;
+#endif
+	}
+
+	// *******************************************************************************************
+	void close() {
+#ifndef _WIN32
+		if (fd != -1) {
+			::close(fd);
+		}
+#endif
+		fd = -1;
+		fileSize = 0;
+	}
+
+	// *******************************************************************************************
+	// Reads up to size bytes starting from offset. Returns number of bytes read (smaller than
+	// requested only at the end of file).
+	size_t read(char* dst, size_t offset, size_t size) const {
+		size_t n_total = 0;
+#ifndef _WIN32
+		while (n_total < size) {
+			ssize_t n = pread(fd, dst + n_total, size - n_total, (off_t)(offset + n_total));
+			if (n == 0) {
+				break;
+			}
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::runtime_error("Error reading distance file");
+			}
+			n_total += (size_t)n;
+		}
+#endif
+		return n_total;
+	}
+};
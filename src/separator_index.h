@@ -0,0 +1,166 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+/*********************************************************************************************************************/
+// Structural index of a block of a distances table. The block is classified in one sweep into
+// bitmasks of field separators (',', '\t', '\r', '\n') and newlines, 64 bytes per word with
+// AVX2, SSE2, or NEON (scalar fallback otherwise). Parsers then walk the bitmasks instead of
+// testing every byte. Separators may be overwritten by the parser after indexing.
+class SeparatorIndex {
+
+	const char* base{ nullptr };
+	const char* end{ nullptr };
+	std::vector<uint64_t> bits;
+	std::vector<uint64_t> newlineBits;
+
+	static bool isNewline(char c) { return c == '\r' || c == '\n'; }
+	static bool isSeparator(char c) { return c == ',' || c == '\t' || isNewline(c); }
+
+	// Returns mask of separators among 64 bytes starting at p and stores mask of newlines.
+	static uint64_t classify64(const char* p, uint64_t& newlines) {
+#if defined(__AVX2__)
+		const __m256i comma = _mm256_set1_epi8(',');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i lf = _mm256_set1_epi8('\n');
+
+		auto classify32 = [&](const char* q, uint64_t& nl) -> uint64_t {
+			__m256i v = _mm256_loadu_si256((const __m256i*)q);
+			__m256i n = _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf));
+			__m256i m = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, comma), _mm256_cmpeq_epi8(v, tab)), n);
+			nl = (uint32_t)_mm256_movemask_epi8(n);
+			return (uint32_t)_mm256_movemask_epi8(m);
+		};
+
+		uint64_t nl_lo, nl_hi;
+		uint64_t mask = classify32(p, nl_lo) | (classify32(p + 32, nl_hi) << 32);
+		newlines = nl_lo | (nl_hi << 32);
+		return mask;
+#elif defined(__SSE2__) || defined(_M_X64)
+		const __m128i comma = _mm_set1_epi8(',');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+
+		uint64_t mask = 0;
+		newlines = 0;
+		for (int i = 0; i < 4; ++i) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+			__m128i n = _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf));
+			__m128i m = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, tab)), n);
+			mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << (16 * i);
+			newlines |= (uint64_t)(uint16_t)_mm_movemask_epi8(n) << (16 * i);
+		}
+
+		return mask;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+		const uint8x16_t comma = vdupq_n_u8(',');
+		const uint8x16_t tab = vdupq_n_u8('\t');
+		const uint8x16_t cr = vdupq_n_u8('\r');
+		const uint8x16_t lf = vdupq_n_u8('\n');
+		const uint8x16_t weights = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+		// pairwise additions gather bits of consecutive bytes into a 64-bit mask
+		auto to_mask = [](const uint8x16_t* m) -> uint64_t {
+			uint8x16_t sum = vpaddq_u8(vpaddq_u8(m[0], m[1]), vpaddq_u8(m[2], m[3]));
+			sum = vpaddq_u8(sum, sum);
+			return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+		};
+
+		uint8x16_t m[4], n[4];
+		for (int i = 0; i < 4; ++i) {
+			uint8x16_t v = vld1q_u8((const uint8_t*)(p + 16 * i));
+			uint8x16_t nl = vorrq_u8(vceqq_u8(v, cr), vceqq_u8(v, lf));
+			uint8x16_t eq = vorrq_u8(vorrq_u8(vceqq_u8(v, comma), vceqq_u8(v, tab)), nl);
+			m[i] = vandq_u8(eq, weights);
+			n[i] = vandq_u8(nl, weights);
+		}
+
+		newlines = to_mask(n);
+		return to_mask(m);
+#else
+		uint64_t mask = 0;
+		newlines = 0;
+		for (int i = 0; i < 64; ++i) {
+			mask |= (uint64_t)isSeparator(p[i]) << i;
+			newlines |= (uint64_t)isNewline(p[i]) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// Returns the first position at or after p marked in the bitmask (or the end of the range).
+	char* find(const std::vector<uint64_t>& mask, const char* p) const {
+		if (p >= end) {
+			return const_cast<char*>(end);
+		}
+
+		size_t pos = p - base;
+		size_t w = pos / 64;
+		uint64_t word = mask[w] & (~0ULL << (pos % 64));
+
+		while (word == 0) {
+			if (++w == mask.size()) {
+				return const_cast<char*>(end);
+			}
+			word = mask[w];
+		}
+
+		const char* q = base + w * 64 + std::countr_zero(word);
+		return const_cast<char*>(q < end ? q : end);
+	}
+
+public:
+
+	// Classifies bytes of [begin, end) range.
+	void build(const char* begin, const char* end) {
+		this->base = begin;
+		this->end = end;
+
+		size_t size = end - begin;
+		size_t n_full = size / 64;
+		bits.resize(n_full + 1);
+		newlineBits.resize(n_full + 1);
+
+		for (size_t i = 0; i < n_full; ++i) {
+			bits[i] = classify64(begin + 64 * i, newlineBits[i]);
+		}
+
+		uint64_t tail = 0, tail_newlines = 0;
+		for (size_t j = n_full * 64; j < size; ++j) {
+			tail |= (uint64_t)isSeparator(begin[j]) << (j - n_full * 64);
+			tail_newlines |= (uint64_t)isNewline(begin[j]) << (j - n_full * 64);
+		}
+		bits[n_full] = tail;
+		newlineBits[n_full] = tail_newlines;
+	}
+
+	// Returns the first separator at or after p (or the end of the range).
+	char* next(const char* p) const { return find(bits, p); }
+
+	// Returns the first newline at or after p (or the end of the range).
+	char* nextNewline(const char* p) const { return find(newlineBits, p); }
+};
@@ -37,7 +37,8 @@ public:
 		for (int i = 0; i < nObjects; ++i) {
 			int obj = objects[i];
 			obj2connections[i].first = obj;
-			obj2connections[i].second = (int)distances.num_neighbours(obj);
+			obj2connections[i].second = (int)std::count_if(distances.begin(obj), distances.end(obj), 
+				[threshold](const Distance& edge) { return edge.get_d() <= threshold; });
 		}
 
 		std::stable_sort(obj2connections.begin(), obj2connections.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
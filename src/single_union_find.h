@@ -0,0 +1,105 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include "distances.h"
+#include "clustering.h"
+#include "union_find.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+
+/** Single linkage as connected components computed in parallel with concurrent union-find.
+	Clusters are numbered in the order of the first object of each component 
+	in the objects vector.
+*/
+template <class Distance>
+class SingleLinkageUnionFind : public IClustering<Distance>
+{
+	int numThreads;
+
+public:
+	SingleLinkageUnionFind(int numThreads) : numThreads(std::max(numThreads, 1)) {}
+
+	int operator() (
+		SparseMatrix<Distance>& distances,
+		const std::vector<int>& objects,
+		const double threshold,
+		std::vector<int>& assignments) override
+	{
+		int nObjects = (int)objects.size();
+		int nRows = (int)distances.num_objects();
+
+		// in the streaming mode components were built during loading
+		ConcurrentUnionFind local;
+		ConcurrentUnionFind* components = distances.components.get();
+
+		if (components) {
+			components->resize(std::max(nObjects, nRows));
+		}
+		else {
+			local.reset(std::max(nObjects, nRows));
+			components = &local;
+			unite(distances, threshold, *components);
+		}
+
+		// number components in the order of objects
+		const int NO_ASSIGNMENT{ -1 };
+		std::vector<int> root2cluster(components->size(), NO_ASSIGNMENT);
+		assignments.resize(nObjects, NO_ASSIGNMENT);
+
+		int cluster_number = 0;
+		for (int i = 0; i < nObjects; ++i) {
+			int obj = objects[i];
+			int& cluster = root2cluster[components->find(obj)];
+			if (cluster == NO_ASSIGNMENT) {
+				cluster = cluster_number++;
+			}
+			assignments[obj] = cluster;
+		}
+
+		return cluster_number;
+	}
+
+protected:
+
+	// Unites ends of edges not exceeding the threshold (rows are processed in parallel).
+	void unite(SparseMatrix<Distance>& distances, double threshold, ConcurrentUnionFind& components) {
+		int nRows = (int)distances.num_objects();
+
+		// rows are distributed in chunks as their lengths may differ a lot
+		const int CHUNK_SIZE = 1024;
+		std::atomic<int> next_row{ 0 };
+		std::vector<std::thread> workers(numThreads);
+
+		for (int tid = 0; tid < numThreads; ++tid) {
+			workers[tid] = std::thread([&distances, &components, &next_row, threshold, nRows, CHUNK_SIZE]() {
+				int first;
+				while ((first = next_row.fetch_add(CHUNK_SIZE)) < nRows) {
+					int last = std::min(first + CHUNK_SIZE, nRows);
+					for (int row = first; row < last; ++row) {
+						// edges are symmetric - it is enough to consider upper rows
+						for (const Distance* edge = distances.begin(row); edge < distances.end(row); ++edge) {
+							if ((int)edge->get_id() > row && edge->get_d() <= threshold) {
+								components.unite(row, edge->get_id());
+							}
+						}
+					}
+				}
+			});
+		}
+
+		for (auto& w : workers) {
+			w.join();
+		}
+	}
+};
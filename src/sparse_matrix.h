@@ -7,33 +7,261 @@
 // *******************************************************************************************
 #pragma once
 #include "distances.h"
+#include "union_find.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <mutex>
 
 
 /*********************************************************************************************************************/
+// Matrix is built row by row during loading (distances) and then compacted to the 
+// compressed sparse row form (offsets + elements) which is used by clustering algorithms.
+// Elements are kept in segments of consecutive rows, so that they can be released in parts
+// when rows are moved to other structures (e.g., linkage heaps).
+//
+// In the half matrix mode every edge is stored once, in the row of the smaller vertex. 
+// Then begin()/end() give only the upper triangle, while the remaining neighbours are 
+// available through the neighbours() iterator. It uses a reverse index (rev_offsets + rev_ids)
+// which is built on the first request, so that algorithms reading the upper triangle only 
+// do not pay for it.
+//
+// In the streaming mode edges are not stored at all - only connected components are built
+// while loading (sufficient for single linkage at the loading threshold).
 template <class Distance>
 class SparseMatrix : public IMatrix
 {
 public:
 
-	size_t n_elements{ 0 };
+	size_t n_elements{ 0 };		// number of neighbours over all rows (each edge counted twice)
+
+	bool half_matrix{ false };
 
+	// rows under construction
 	std::vector<std::vector<Distance>> distances;
 
+	// compressed sparse rows: elements of row i are in [offsets[i], offsets[i + 1]) range of 
+	// a sequence formed by segments, each segment stores 2^segment_bits consecutive rows
+	std::vector<size_t> offsets{ 0 };
+	std::vector<std::vector<Distance>> segments;
+	int segment_bits{ 0 };
+
+	// reverse index of a half matrix: rows j < i having i as a neighbour (built lazily)
+	mutable std::vector<size_t> rev_offsets;
+	mutable std::vector<uint32_t> rev_ids;
+	mutable std::atomic<bool> rev_built{ false };
+	mutable std::mutex rev_mtx;
+
+	// components of the graph (streaming mode only)
+	std::unique_ptr<ConcurrentUnionFind> components;
+
+	// *******************************************************************************************
+	// Iterator over all neighbours of a row in both full and half modes.
+	class neighbour_iterator {
+		const SparseMatrix* matrix;
+		int row;
+		const Distance* p;
+		const Distance* p_end;
+		const uint32_t* r;
+
+	public:
+		neighbour_iterator(const SparseMatrix* matrix, int row, const Distance* p, const uint32_t* r)
+			: matrix(matrix), row(row), p(p), p_end(matrix->end(row)), r(r) {}
+
+		Distance operator*() const { return (p != p_end) ? *p : matrix->mirror(*r, row); }
+
+		neighbour_iterator& operator++() {
+			if (p != p_end) { ++p; }
+			else { ++r; }
+			return *this;
+		}
+
+		bool operator==(const neighbour_iterator& rhs) const { return p == rhs.p && r == rhs.r; }
+		bool operator!=(const neighbour_iterator& rhs) const { return !(*this == rhs); }
+	};
+
+	class neighbour_range {
+		const SparseMatrix* matrix;
+		int row;
+
+	public:
+		neighbour_range(const SparseMatrix* matrix, int row) : matrix(matrix), row(row) {}
+
+		neighbour_iterator begin() const { return neighbour_iterator(matrix, row, matrix->begin(row), matrix->rev_begin(row)); }
+		neighbour_iterator end() const { return neighbour_iterator(matrix, row, matrix->end(row), matrix->rev_end(row)); }
+	};
+
 	SparseMatrix() {}
 
 	virtual ~SparseMatrix() {}
 
-	size_t num_objects() const { return distances.size(); }
+	size_t num_objects() const { return offsets.size() - 1; }
 
 	size_t num_elements() const { return n_elements; }
 
-	size_t num_neighbours(int i) const { return distances[i].size(); }
+	size_t num_neighbours(int i) const { 
+		if (!half_matrix) {
+			return offsets[i + 1] - offsets[i];
+		}
+		reverse_index();
+		return offsets[i + 1] - offsets[i] + rev_offsets[i + 1] - rev_offsets[i]; 
+	}
 
-	const Distance* begin(int row_id) const { return distances[row_id].data(); }
-	const Distance* end(int row_id) const { return distances[row_id].data() + distances[row_id].size(); }
+	size_t num_stored() const { return offsets.back(); }
 
-	void clear_row(int row_id) { std::vector<Distance>().swap(distances[row_id]); }
-};
+	const Distance* begin(int row_id) const { 
+		int s = row_id >> segment_bits;
+		return segments[s].data() + (offsets[row_id] - offsets[(size_t)s << segment_bits]);
+	}
+	
+	const Distance* end(int row_id) const { 
+		int s = row_id >> segment_bits;
+		return segments[s].data() + (offsets[row_id + 1] - offsets[(size_t)s << segment_bits]);
+	}
+
+	// *******************************************************************************************
+	// Segments
+
+	int num_segments() const { return (int)segments.size(); }
+
+	int segment_of(int row_id) const { return row_id >> segment_bits; }
+
+	int segment_first_row(int s) const { return s << segment_bits; }
 
+	int segment_last_row(int s) const { return (int)std::min(((size_t)s + 1) << segment_bits, num_objects()); }
+
+	// Prepares empty segments for the current offsets (at most few hundreds of segments).
+	void init_segments() {
+		size_t n_rows = num_objects();
+		segment_bits = 10;
+		while ((n_rows >> segment_bits) > 256) {
+			++segment_bits;
+		}
+		segments.clear();
+		segments.resize((n_rows + ((size_t)1 << segment_bits) - 1) >> segment_bits);
+	}
+
+	// Allocates elements of a segment.
+	std::vector<Distance>& allocate_segment(int s) {
+		segments[s].resize(offsets[segment_last_row(s)] - offsets[segment_first_row(s)]);
+		return segments[s];
+	}
+
+	// Releases elements of a segment (its rows must not be accessed afterwards).
+	void release_segment(int s) { std::vector<Distance>().swap(segments[s]); }
+
+	// Invokes a function on pieces [first, last) of elements with positions in [lo, hi) range.
+	template <class Function>
+	void for_each_element_range(size_t lo, size_t hi, const Function& function) const {
+		for (int s = segment_of_element(lo); s < num_segments() && lo < hi; ++s) {
+			size_t base = offsets[segment_first_row(s)];
+			size_t seg_end = std::min(hi, base + segments[s].size());
+			if (lo < seg_end) {
+				function(segments[s].data() + (lo - base), segments[s].data() + (seg_end - base));
+				lo = seg_end;
+			}
+		}
+	}
+
+	// *******************************************************************************************
+	// Releases segments when all their rows were read (rows can be read concurrently).
+	class segment_releaser {
+		SparseMatrix& m;
+		std::unique_ptr<std::atomic<int>[]> remaining;
+
+	public:
+		segment_releaser(SparseMatrix& m) : m(m), remaining(new std::atomic<int>[m.num_segments()]) {
+			for (int s = 0; s < m.num_segments(); ++s) {
+				remaining[s] = m.segment_last_row(s) - m.segment_first_row(s);
+			}
+		}
+
+		// Marks row as read (or not needed).
+		void done(int row_id) {
+			int s = m.segment_of(row_id);
+			if (--remaining[s] == 0) {
+				m.release_segment(s);
+			}
+		}
+	};
+
+	neighbour_range neighbours(int row_id) const { 
+		if (half_matrix) {
+			reverse_index();
+		}
+		return neighbour_range(this, row_id); 
+	}
+
+	// Releases elements leaving all rows empty.
+	void clear_rows() { 
+		for (auto& seg : segments) {
+			std::vector<Distance>().swap(seg);
+		}
+		std::fill(offsets.begin(), offsets.end(), 0);
+		std::vector<uint32_t>().swap(rev_ids);
+		std::vector<size_t>().swap(rev_offsets);
+		rev_built = false;
+		n_elements = 0;
+	}
+
+private:
+	// Builds reverse index of a half matrix if necessary (thread-safe).
+	void reverse_index() const {
+		if (rev_built.load(std::memory_order_acquire)) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lck(rev_mtx);
+		if (!rev_built.load(std::memory_order_relaxed)) {
+			build_reverse_index();
+			rev_built.store(true, std::memory_order_release);
+		}
+	}
+
+	void build_reverse_index() const {
+		size_t n_rows = num_objects();
+		rev_offsets.assign(n_rows + 1, 0);
+		rev_ids.resize(num_stored());
+
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (const Distance* e = begin((int)i); e < end((int)i); ++e) {
+				++rev_offsets[e->get_id() + 1];
+			}
+		}
+		for (size_t i = 0; i < n_rows; ++i) {
+			rev_offsets[i + 1] += rev_offsets[i];
+		}
+
+		// rows are processed in order, thus reverse rows are sorted
+		std::vector<size_t> pos(rev_offsets.begin(), rev_offsets.end() - 1);
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (const Distance* e = begin((int)i); e < end((int)i); ++e) {
+				rev_ids[pos[e->get_id()]++] = (uint32_t)i;
+			}
+		}
+	}
+
+	int segment_of_element(size_t pos) const {
+		// the last row with offset not greater than pos
+		size_t row = std::upper_bound(offsets.begin(), offsets.end(), pos) - offsets.begin() - 1;
+		return (int)(std::min(row, num_objects() - (num_objects() > 0)) >> segment_bits);
+	}
+
+	const uint32_t* rev_begin(int row_id) const { return half_matrix ? rev_ids.data() + rev_offsets[row_id] : nullptr; }
+	const uint32_t* rev_end(int row_id) const { return half_matrix ? rev_ids.data() + rev_offsets[row_id + 1] : nullptr; }
+
+	// Returns edge (src, row) stored in the row src as seen from the row.
+	Distance mirror(uint32_t src, int row) const {
+		if constexpr (Distance::HAS_DISTANCE) {
+			const Distance* e = std::lower_bound(begin(src), end(src), (uint32_t)row,
+				[](const Distance& a, uint32_t id) { return a.get_id() < id; });
+			return Distance(src, e->get_d());
+		}
+		else {
+			return Distance(src, 0.0);
+		}
+	}
+};
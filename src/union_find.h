@@ -0,0 +1,108 @@
+#pragma once
+
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+
+
+// *******************************************************************************************
+// Lock-free disjoint set forest which can be updated by many threads at the same time.
+// Roots are always hooked under smaller roots, thus every set is represented by its minimal
+// element and ids along any path decrease (no cycles may appear regardless of interleaving).
+// Paths are shortened by halving with CAS - a failed CAS means that other thread has already
+// shortened the path.
+// *******************************************************************************************
+class ConcurrentUnionFind {
+
+	std::unique_ptr<std::atomic<int>[]> parents;
+	int n_elements{ 0 };
+	int capacity{ 0 };
+
+public:
+	ConcurrentUnionFind() {}
+	ConcurrentUnionFind(int n) { reset(n); }
+
+	int size() const { return n_elements; }
+
+	// *******************************************************************************************
+	// Not thread-safe.
+	void reset(int n) {
+		n_elements = capacity = n;
+		parents.reset(new std::atomic<int>[n]);
+		for (int i = 0; i < n; ++i) {
+			parents[i].store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// *******************************************************************************************
+	// Not thread-safe. Enlarges the structure with singletons preserving existing sets
+	// (storage grows by factor 1.5, so that it can be extended often when vertices arrive).
+	void resize(int n) {
+		if (n <= n_elements) {
+			return;
+		}
+
+		if (n > capacity) {
+			capacity = std::max(n, capacity + capacity / 2);
+			std::unique_ptr<std::atomic<int>[]> tmp(new std::atomic<int>[capacity]);
+			for (int i = 0; i < n_elements; ++i) {
+				tmp[i].store(parents[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			parents = std::move(tmp);
+		}
+
+		for (int i = n_elements; i < n; ++i) {
+			parents[i].store(i, std::memory_order_relaxed);
+		}
+		n_elements = n;
+	}
+
+	// *******************************************************************************************
+	int find(int x) {
+		while (true) {
+			int p = parents[x].load(std::memory_order_relaxed);
+			if (p == x) {
+				return x;
+			}
+
+			int gp = parents[p].load(std::memory_order_relaxed);
+			if (p != gp) {
+				parents[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+			}
+			x = gp;
+		}
+	}
+
+	// *******************************************************************************************
+	// Returns true if two different sets were merged.
+	bool unite(int a, int b) {
+		while (true) {
+			a = find(a);
+			b = find(b);
+
+			if (a == b) {
+				return false;
+			}
+
+			if (a > b) {
+				std::swap(a, b);
+			}
+
+			// b may have been hooked by other thread in the meantime - retry
+			int expected = b;
+			if (parents[b].compare_exchange_strong(expected, a, std::memory_order_acq_rel)) {
+				return true;
+			}
+		}
+	}
+};
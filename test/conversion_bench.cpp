@@ -0,0 +1,175 @@
+// *******************************************************************************************
+// This file is a part of Clusty software distributed under GNU GPL 3 license.
+// The homepage of the Clusty project is https://github.com/refresh-bio/Clusty
+//
+// Copyright(C) 2024-2025, A.Gudys, K.Siminski, S.Deorowicz
+//
+// *******************************************************************************************
+
+// Micro-benchmark of numeric conversions: SWAR (Conversions::strtod/strtol) against scalar
+// (Conversions::strtod_scalar/strtol_scalar) parsers. Both have to give bitwise identical
+// values and end pointers on numeric fields of the tables and on random fields.
+// Usage: conversion-bench <n_repetitions> <table_1> [<table_2> ...]
+
+#include "conversion.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+
+// numeric fields as zero-terminated strings in a single buffer
+struct Fields {
+	std::vector<char> buffer;
+	std::vector<size_t> reals, integers;
+
+	void add(const std::string& field) {
+		(field.find_first_of(".eE") == std::string::npos ? integers : reals).push_back(buffer.size());
+		buffer.insert(buffer.end(), field.begin(), field.end());
+		buffer.push_back(0);
+	}
+
+	// SWAR parsers may read a word past the end of a field
+	void pad() { buffer.resize(buffer.size() + 8); }
+};
+
+// *******************************************************************************************
+// Loads numeric fields of a TSV/CSV table (header is skipped).
+Fields loadTable(const std::string& fileName) {
+	std::ifstream ifs(fileName);
+	if (!ifs) {
+		throw std::runtime_error("Unable to open " + fileName);
+	}
+
+	Fields fields;
+	std::string line;
+	std::getline(ifs, line);
+	while (std::getline(ifs, line)) {
+		std::istringstream iss(line);
+		std::string field;
+		while (std::getline(iss, field, line.find('\t') != std::string::npos ? '\t' : ',')) {
+			if (!field.empty() && (isdigit(field[0]) || field[0] == '-' || field[0] == '.')) {
+				fields.add(field);
+			}
+		}
+	}
+	fields.pad();
+	return fields;
+}
+
+// *******************************************************************************************
+// Generates random fields of various shapes (short and long mantissas, signs, exponents).
+Fields randomFields(size_t n_fields) {
+	std::mt19937_64 gen(0);
+	auto digits = [&gen](int n) {
+		std::string s;
+		for (int i = 0; i < n; ++i) {
+			s.push_back('0' + (char)(gen() % 10));
+		}
+		return s;
+	};
+
+	Fields fields;
+	for (size_t i = 0; i < n_fields; ++i) {
+		std::string f = (gen() % 4 == 0) ? "-" : "";
+		f += digits(1 + gen() % 20);
+		if (gen() % 2) {
+			f += '.';
+			f += digits(gen() % 20);
+			if (gen() % 8 == 0) {
+				f += (gen() % 2) ? "e-" : "e";
+				f += digits(1 + gen() % 2);
+			}
+		}
+		fields.add(f);
+	}
+	fields.pad();
+	return fields;
+}
+
+// *******************************************************************************************
+// Returns number of fields with different values or end pointers.
+size_t countMismatches(Fields& f) {
+	size_t n_mismatches = 0;
+	for (size_t pos : f.reals) {
+		char *e1, *e2;
+		double v1 = Conversions::strtod_scalar(f.buffer.data() + pos, &e1), v2 = Conversions::strtod(f.buffer.data() + pos, &e2);
+		n_mismatches += (std::memcmp(&v1, &v2, sizeof(double)) != 0 || e1 != e2);
+	}
+	for (size_t pos : f.integers) {
+		char *e1, *e2;
+		n_mismatches += (Conversions::strtol_scalar(f.buffer.data() + pos, &e1) != Conversions::strtol(f.buffer.data() + pos, &e2) || e1 != e2);
+	}
+	return n_mismatches;
+}
+
+// *******************************************************************************************
+// Returns time of converting all fields n_repetitions times and a checksum.
+template <class F>
+std::pair<double, double> run(Fields& f, const std::vector<size_t>& positions, int n_repetitions, F conversion) {
+	double checksum = 0;
+	auto t = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < n_repetitions; ++r) {
+		for (size_t pos : positions) {
+			checksum += (double)conversion(f.buffer.data() + pos, nullptr);
+		}
+	}
+	auto dt = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t).count();
+	return std::make_pair(dt, checksum);
+}
+
+// *******************************************************************************************
+size_t benchmark(const std::string& name, Fields& f, int n_repetitions) {
+
+	size_t n_mismatches = countMismatches(f);
+
+	auto d_scalar = run(f, f.reals, n_repetitions, Conversions::strtod_scalar);
+	auto d_swar = run(f, f.reals, n_repetitions, Conversions::strtod);
+	auto l_scalar = run(f, f.integers, n_repetitions, Conversions::strtol_scalar);
+	auto l_swar = run(f, f.integers, n_repetitions, Conversions::strtol);
+
+	// checksums are compared so that conversions are not optimised out
+	n_mismatches += (d_scalar.second != d_swar.second) + (l_scalar.second != l_swar.second);
+
+	std::cout << name << ": " << f.reals.size() << " real and " << f.integers.size() << " integer fields, "
+		<< n_repetitions << " repetitions, " << n_mismatches << " mismatches" << std::endl
+		<< "  strtod [s]: scalar " << d_scalar.first << ", swar " << d_swar.first << std::endl
+		<< "  strtol [s]: scalar " << l_scalar.first << ", swar " << l_swar.first << std::endl;
+
+	return n_mismatches;
+}
+
+// *******************************************************************************************
+int main(int argc, char** argv) {
+
+	if (argc < 3) {
+		std::cerr << "USAGE: conversion-bench <n_repetitions> <table_1> [<table_2> ...]" << std::endl;
+		return -1;
+	}
+
+	int n_repetitions = std::atoi(argv[1]);
+	size_t n_mismatches = 0;
+
+	try {
+		for (int i = 2; i < argc; ++i) {
+			Fields f = loadTable(argv[i]);
+			n_mismatches += benchmark(argv[i], f, n_repetitions);
+		}
+
+		Fields f = randomFields(1000000);
+		n_mismatches += benchmark("random", f, 1);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+
+	return n_mismatches == 0 ? 0 : -1;
+}
@@ -19,3 +19,17 @@ set PY=C:\Python\Python312\python.exe
 %PY% ../cmp.py vir61.complete.95.python.csv vir61.complete.95.reps
 %PY% ../cmp.py vir61.complete.70.python.csv vir61.complete.70
 %PY% ../cmp.py vir61.complete.70.python.csv vir61.complete.70.reps
+
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.95 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.95
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.95 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.95.reps --out-representatives
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.80 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.80
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.80 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.80.reps --out-representatives
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.70 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.70
+%EXE% --algo average --objects-file vir61.list --similarity --min ani 0.70 --id-cols id2 id1 --distance-col ani vir61.ani vir61.average.70.reps --out-representatives
+
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.95 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.95
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.95 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.95.reps --out-representatives
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.80 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.80
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.80 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.80.reps --out-representatives
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.70 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.70
+%EXE% --algo weighted --objects-file vir61.list --similarity --min ani 0.70 --id-cols id2 id1 --distance-col ani vir61.ani vir61.weighted.70.reps --out-representatives